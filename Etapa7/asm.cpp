@@ -4,17 +4,30 @@
 #include "asm.hpp"
 #include "tac.hpp"
 #include "symbol.hpp"
+#include "vectorizer.hpp"
+#include "jumptable.hpp"
+#include "peephole.hpp"
+#include "elf.hpp"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <fstream>
 #include <unordered_map>
+#include <set>
 #include <vector>
 #include <cctype>
 #include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+// Run of consecutive PRINT instructions written together, the literal text between its values merged at compile time
+struct PrintGroup {
+    std::vector<std::string> texts;     // Label of the text before each value and after the last one ("" when empty)
+    std::vector<Symbol*> values;        // Variables printed as decimal integers, in order
+};
 
 // Global state variables
-std::ofstream* outFile = nullptr;                                    // Output file stream
+std::ostream* outFile = nullptr;                                     // Output stream (the assembly is buffered before being written)
 std::unordered_map<std::string, std::string> varLocations;          // Variable to memory location mapping
 std::unordered_map<std::string, int> vectorSizes;                   // Vector name to size mapping
 std::vector<std::string> stringLiterals;                            // String literals storage
@@ -23,14 +36,25 @@ int labelCounter = 0;                                               // Counter f
 int stringCounter = 0;                                              // Counter for string literals
 std::string currentRegister = "%rax";                               // Currently used register (usually %rax)
 std::string currentFunction = "";                                   // Current function being processed
-std::unordered_map<std::string, int> functionParamCount;            // Function name to parameter count mapping
-int currentParamOffset = 16;                                        // Current parameter offset (starts at 16(%rbp))
+int currentParamIndex = 0;                                          // Position of the next PARAM of the current function
+std::vector<std::string> pendingArguments;                          // Values of the ARGs not yet consumed by a CALL
+std::unordered_map<TAC*, std::string> argumentCopies;               // ARGs whose value is copied to a slot of their own when reached
+bool optimizeCode = false;                                          // Use cheaper instruction sequences (strength reduction)
+bool useAVX2 = false;                                               // Vectorized loops use AVX2 (8 lanes) instead of SSE2 (4 lanes)
+bool freestandingProgram = false;                                   // Program starts at its own _start and runs without libc
+std::set<TAC*> fusedComparisons;                                    // Comparisons emitted together with the IFZ/IFNZ that follows them
+std::set<TAC*> tailCalls;                                           // Returns whose value comes from the call right before them
+std::set<Symbol*> loopLabels;                                       // Labels reached by a backward branch, aligned in optimized code
+std::set<TAC*> scaledMultiplies;                                    // Multiplications by 2, 4 or 8 computed by the lea of the next addition
+bool framelessFunction = false;                                     // Current function keeps its slots in the red zone, without %rbp
+const int RED_ZONE_SIZE = 128;                                      // Bytes below %rsp that leaf functions may use without reserving them
+std::unordered_map<TAC*, PrintGroup> printGroups;                   // Last PRINT of each run, which prints the whole run
+std::set<TAC*> fusedPrints;                                         // Other PRINTs of those runs (written by the last one)
 
 // Utility functions
 std::string getOperandLocation(class Symbol* symbol);
 std::string getOperandValue(class Symbol* symbol);
 std::string allocateVariable(const std::string& name, int size = 4);
-std::string allocateParameter(const std::string& name);
 std::string allocateVector(const std::string& name, int elements);
 std::string getStringLabel(const std::string& str);
 void emitInstruction(const std::string& instruction);
@@ -40,6 +64,21 @@ void processInstruction(class TAC* current);
 int evaluateExpression(const std::string& expression);
 void loadOperandToRegister(const std::string& operand, const std::string& reg);
 void storeRegisterToOperand(const std::string& reg, const std::string& operand);
+int planFrame(TAC* first, TAC* last);
+bool isStackLocation(const std::string& operand);
+void emitPrologue(const std::string& name, TAC* first, TAC* last);
+void emitEpilogue(const std::string& name);
+bool getImmediateValue(const std::string& operand, int& value);
+void emitMultiplyByConstant(int constant);
+void emitDivideByConstant(int divisor);
+void emitModuloByConstant(int divisor);
+void emitVectorLoop(TAC* current);
+void findFusedComparisons(TAC* tacHead);
+void findLoopLabels(TAC* tacHead);
+void findScaledAdditions(TAC* tacHead);
+void findPrintGroups(TAC* tacHead);
+bool selectInstruction(TAC* tac, TAC* source);
+void emitBulkLoop(const VectorKernel* kernel);
 
 
 std::string getOperandLocation(Symbol* symbol) {
@@ -53,10 +92,9 @@ std::string getOperandLocation(Symbol* symbol) {
         return it->second;
     }
     
-    // If we're in a function other than main, and this is an unknown variable,
-    // treat it as a function parameter
-    if (currentFunction != "main" && currentFunction != "") {
-        return allocateParameter(name);
+    // Pointer temporaries hold 64-bit addresses
+    if (symbol->getIdentifierType() == identifierType::TEMP && symbol->getDataType() == dataType::ADDRESS) {
+        return allocateVariable(name, 8);
     }
     
     // Allocate new location on the stack (for non-global variables)
@@ -94,27 +132,20 @@ std::string allocateVariable(const std::string& name, int size) {
         return it->second;
     }
     
+    stackOffset = (stackOffset + size - 1) / size * size; // Keep the slot naturally aligned
     stackOffset += size;
-    std::string location = "-" + std::to_string(stackOffset) + "(%rbp)";
+    std::string location = "-" + std::to_string(stackOffset) + (framelessFunction ? "(%rsp)" : "(%rbp)");
     varLocations[name] = location;
     return location;
 }
 
-std::string allocateParameter(const std::string& name) {
-    auto it = varLocations.find(name);
-    if (it != varLocations.end()) {
-        return it->second;
-    }
-    
-    // For user-defined functions, parameters come in registers (%edi, %esi, %edx, %ecx)
-    // We'll map them to stack locations and move them there at function start
-    stackOffset += 4;
-    std::string location = "-" + std::to_string(stackOffset) + "(%rbp)";
-    varLocations[name] = location;
-    
-    return location;
+// Helper function to check whether an operand lives in the frame of the current function
+bool isStackLocation(const std::string& operand) {
+    return operand.find("(%rbp)") != std::string::npos || operand.find("(%rsp)") != std::string::npos;
 }
 
+
+
 std::string allocateVector(const std::string& name, int elements) {
     return allocateVariable(name, elements * 8);  // 8 bytes per element in 64-bit
 }
@@ -141,7 +172,7 @@ void loadOperandToRegister(const std::string& operand, const std::string& reg) {
     if (operand[0] == '$') {
         // Immediate value
         emitInstruction("movl " + operand + ", " + reg);
-    } else if (operand.find("(%rbp)") != std::string::npos) {
+    } else if (isStackLocation(operand)) {
         // Stack variable
         emitInstruction("movl " + operand + ", " + reg);
     } else {
@@ -152,7 +183,7 @@ void loadOperandToRegister(const std::string& operand, const std::string& reg) {
 
 // Helper function to store register to operand (PIE-compatible)
 void storeRegisterToOperand(const std::string& reg, const std::string& operand) {
-    if (operand.find("(%rbp)") != std::string::npos) {
+    if (isStackLocation(operand)) {
         // Stack variable
         emitInstruction("movl " + reg + ", " + operand);
     } else {
@@ -161,6 +192,1172 @@ void storeRegisterToOperand(const std::string& reg, const std::string& operand)
     }
 }
 
+// Helper function to read the value of an immediate operand ("$N")
+bool getImmediateValue(const std::string& operand, int& value) {
+    if (operand.size() < 2 || operand[0] != '$') return false;
+
+    char* end = nullptr;
+    long parsed = std::strtol(operand.c_str() + 1, &end, 10);
+    if (*end != '\0' || parsed < INT32_MIN || parsed > INT32_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Helper function to get k when value == 2^k, or -1 otherwise
+int powerOfTwoExponent(long long value) {
+    if (value <= 0 || (value & (value - 1)) != 0) return -1;
+    int exponent = 0;
+    while ((1LL << exponent) != value) exponent++;
+    return exponent;
+}
+
+// Helper function to compute the magic multiplier and shift for signed division by a constant
+// (Hacker's Delight, section 10-4); divisor must not be -1, 0 or 1
+void computeDivisionMagic(int divisor, int& multiplier, int& shift) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t absDivisor = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+    uint32_t t = two31 + (static_cast<uint32_t>(divisor) >> 31);
+    uint32_t absNc = t - 1 - t % absDivisor;
+    int p = 31;
+    uint32_t q1 = two31 / absNc;
+    uint32_t r1 = two31 - q1 * absNc;
+    uint32_t q2 = two31 / absDivisor;
+    uint32_t r2 = two31 - q2 * absDivisor;
+    uint32_t delta;
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= absNc) { q1++; r1 -= absNc; }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= absDivisor) { q2++; r2 -= absDivisor; }
+        delta = absDivisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    uint32_t magic = q2 + 1;
+    if (divisor < 0) magic = 0u - magic;
+    multiplier = static_cast<int>(static_cast<int32_t>(magic));
+    shift = p - 32;
+}
+
+// Helper function to multiply %eax by a constant with shifts and lea instead of imull when possible
+void emitMultiplyByConstant(int constant) {
+    long long magnitude = constant < 0 ? -static_cast<long long>(constant) : constant;
+    int exponent = powerOfTwoExponent(magnitude);
+
+    if (exponent >= 0) {
+        if (exponent > 0) emitInstruction("sall $" + std::to_string(exponent) + ", %eax");
+    } else if (magnitude == 3 || magnitude == 5 || magnitude == 9) {
+        emitInstruction("leal (%eax,%eax," + std::to_string(magnitude - 1) + "), %eax");
+    } else if (powerOfTwoExponent(magnitude - 1) > 0) {
+        // x * (2^k + 1) = (x << k) + x
+        emitInstruction("movl %eax, %ecx");
+        emitInstruction("sall $" + std::to_string(powerOfTwoExponent(magnitude - 1)) + ", %eax");
+        emitInstruction("addl %ecx, %eax");
+    } else if (powerOfTwoExponent(magnitude + 1) > 0) {
+        // x * (2^k - 1) = (x << k) - x
+        emitInstruction("movl %eax, %ecx");
+        emitInstruction("sall $" + std::to_string(powerOfTwoExponent(magnitude + 1)) + ", %eax");
+        emitInstruction("subl %ecx, %eax");
+    } else {
+        emitInstruction("imull $" + std::to_string(constant) + ", %eax, %eax");
+        return;
+    }
+
+    if (constant < 0) emitInstruction("negl %eax");
+}
+
+// Helper function to divide %eax by a constant (truncating like idivl) without a divide instruction
+// The dividend is left in %ecx
+void emitDivideByConstant(int divisor) {
+    long long magnitude = divisor < 0 ? -static_cast<long long>(divisor) : divisor;
+    int exponent = powerOfTwoExponent(magnitude);
+    emitInstruction("movl %eax, %ecx");
+
+    if (exponent > 0) {
+        // Negative dividends are biased by 2^k - 1 so the arithmetic shift rounds towards zero
+        emitInstruction("movl %eax, %edx");
+        emitInstruction("sarl $31, %edx");
+        emitInstruction("shrl $" + std::to_string(32 - exponent) + ", %edx");
+        emitInstruction("addl %edx, %eax");
+        emitInstruction("sarl $" + std::to_string(exponent) + ", %eax");
+        if (divisor < 0) emitInstruction("negl %eax");
+        return;
+    }
+
+    int multiplier = 0;
+    int shift = 0;
+    computeDivisionMagic(divisor, multiplier, shift);
+    emitInstruction("movl $" + std::to_string(multiplier) + ", %edx");
+    emitInstruction("imull %edx");
+    if (divisor > 0 && multiplier < 0) emitInstruction("addl %ecx, %edx");
+    if (divisor < 0 && multiplier > 0) emitInstruction("subl %ecx, %edx");
+    if (shift > 0) emitInstruction("sarl $" + std::to_string(shift) + ", %edx");
+    // Add one to negative quotients to round towards zero
+    emitInstruction("movl %edx, %eax");
+    emitInstruction("shrl $31, %eax");
+    emitInstruction("addl %edx, %eax");
+}
+
+// Helper function to compute %eax modulo a constant (with the sign of the dividend, like idivl)
+void emitModuloByConstant(int divisor) {
+    long long magnitude = divisor < 0 ? -static_cast<long long>(divisor) : divisor;
+    int exponent = powerOfTwoExponent(magnitude);
+
+    if (exponent > 0) {
+        // r = x - ((x + bias) & -2^k), with the same bias used by the division
+        emitInstruction("movl %eax, %edx");
+        emitInstruction("sarl $31, %edx");
+        emitInstruction("shrl $" + std::to_string(32 - exponent) + ", %edx");
+        emitInstruction("addl %eax, %edx");
+        emitInstruction("andl $" + std::to_string(-(1LL << exponent)) + ", %edx");
+        emitInstruction("subl %edx, %eax");
+        return;
+    }
+
+    // r = x - (x / d) * d
+    emitDivideByConstant(divisor);
+    emitInstruction("imull $" + std::to_string(divisor) + ", %eax, %eax");
+    emitInstruction("subl %eax, %ecx");
+    emitInstruction("movl %ecx, %eax");
+}
+
+// Scratch vector registers of the vectorized loops (kernel nodes use the lower ones)
+const int VECTOR_SCRATCH = 13;
+const int VECTOR_SCRATCH2 = 14;
+const int VECTOR_SCRATCH3 = 15;
+
+// Helper function to name a vector register (ymm registers only inside AVX2 packed code)
+std::string vectorRegister(int number, bool wide) {
+    return (wide ? "%ymm" : "%xmm") + std::to_string(number);
+}
+
+// Helper function to emit destination = left op right with a packed integer instruction (SSE2 mnemonic)
+void emitPackedOperation(const std::string& operation, int left, int right, int destination, bool wide) {
+    std::string leftReg = vectorRegister(left, wide);
+    std::string rightReg = vectorRegister(right, wide);
+    std::string destinationReg = vectorRegister(destination, wide);
+    if (useAVX2) {
+        emitInstruction("v" + operation + " " + rightReg + ", " + leftReg + ", " + destinationReg);
+        return;
+    }
+    if (destination != left) {
+        emitInstruction("movdqa " + leftReg + ", " + destinationReg);
+    }
+    emitInstruction(operation + " " + rightReg + ", " + destinationReg);
+}
+
+// Helper function to emit destination = left * right on 32-bit lanes
+void emitPackedMultiply(int left, int right, int destination, bool wide) {
+    if (useAVX2) {
+        emitPackedOperation("pmulld", left, right, destination, wide);
+        return;
+    }
+
+    // SSE2 only multiplies the even lanes (pmuludq), so the odd lanes are shifted down and multiplied apart
+    std::string odd = vectorRegister(VECTOR_SCRATCH2, false);
+    std::string oddRight = vectorRegister(VECTOR_SCRATCH3, false);
+    std::string destinationReg = vectorRegister(destination, false);
+    emitInstruction("movdqa " + vectorRegister(left, false) + ", " + odd);
+    emitInstruction("psrlq $32, " + odd);
+    emitInstruction("movdqa " + vectorRegister(right, false) + ", " + oddRight);
+    emitInstruction("psrlq $32, " + oddRight);
+    emitInstruction("pmuludq " + oddRight + ", " + odd);
+    emitPackedOperation("pmuludq", left, right, destination, false);
+    emitInstruction("pshufd $8, " + destinationReg + ", " + destinationReg);
+    emitInstruction("pshufd $8, " + odd + ", " + odd);
+    emitInstruction("punpckldq " + odd + ", " + destinationReg);
+}
+
+// Helper function to keep in accumulator the lane-wise max (or min) of accumulator and value
+void emitPackedMaxMin(int accumulator, int value, bool max, bool wide) {
+    if (useAVX2) {
+        emitPackedOperation(max ? "pmaxsd" : "pminsd", accumulator, value, accumulator, wide);
+        return;
+    }
+
+    // SSE2 has no signed 32-bit max/min: blend with the mask of the lanes where value wins
+    std::string mask = vectorRegister(VECTOR_SCRATCH, false);
+    std::string taken = vectorRegister(VECTOR_SCRATCH2, false);
+    std::string accumulatorReg = vectorRegister(accumulator, false);
+    std::string valueReg = vectorRegister(value, false);
+    if (max) {
+        emitInstruction("movdqa " + valueReg + ", " + mask);
+        emitInstruction("pcmpgtd " + accumulatorReg + ", " + mask);
+    } else {
+        emitInstruction("movdqa " + accumulatorReg + ", " + mask);
+        emitInstruction("pcmpgtd " + valueReg + ", " + mask);
+    }
+    emitInstruction("movdqa " + valueReg + ", " + taken);
+    emitInstruction("pand " + mask + ", " + taken);
+    emitInstruction("pandn " + accumulatorReg + ", " + mask);
+    emitInstruction("por " + taken + ", " + mask);
+    emitInstruction("movdqa " + mask + ", " + accumulatorReg);
+}
+
+// Helper function to combine the lanes of a reduction register into %ecx
+void emitHorizontalReduction(int accumulator, ReductionKind kind) {
+    std::string accumulatorReg = vectorRegister(accumulator, false);
+    std::string scratch = vectorRegister(VECTOR_SCRATCH3, false);
+    std::string prefix = useAVX2 ? "v" : "";
+
+    auto combine = [&]() {
+        if (kind == ReductionKind::MAX || kind == ReductionKind::MIN) {
+            emitPackedMaxMin(accumulator, VECTOR_SCRATCH3, kind == ReductionKind::MAX, false);
+        } else {
+            emitPackedOperation("paddd", accumulator, VECTOR_SCRATCH3, accumulator, false);
+        }
+    };
+
+    if (useAVX2) {
+        emitInstruction("vextracti128 $1, " + vectorRegister(accumulator, true) + ", " + scratch);
+        combine();
+    }
+    emitInstruction(prefix + "pshufd $0x4E, " + accumulatorReg + ", " + scratch);
+    combine();
+    emitInstruction(prefix + "pshufd $0xB1, " + accumulatorReg + ", " + scratch);
+    combine();
+    emitInstruction(prefix + "movd " + accumulatorReg + ", %ecx");
+}
+
+// Helper function to copy %ecx to every lane of a vector register
+void emitBroadcast(int destination) {
+    if (useAVX2) {
+        emitInstruction("vmovd %ecx, " + vectorRegister(destination, false));
+        emitInstruction("vpbroadcastd " + vectorRegister(destination, false) + ", " + vectorRegister(destination, true));
+    } else {
+        emitInstruction("movd %ecx, " + vectorRegister(destination, false));
+        emitInstruction("pshufd $0, " + vectorRegister(destination, false) + ", " + vectorRegister(destination, false));
+    }
+}
+
+// Fill/copy loop: every store becomes one rep stosl (fill) or rep movsl (copy) over the whole range
+void emitBulkLoop(const VectorKernel* kernel) {
+    std::string skipLabel = "bulkloop_skip_" + std::to_string(labelCounter++);
+    emitComment("Fill/copy loop: " + kernel->index->getLexeme() + (kernel->inclusive ? " <= " : " < ") +
+                kernel->limit->getLexeme());
+
+    // %r9 = index, %r8 = number of elements, %edx = final value of the index
+    loadOperandToRegister(getOperandValue(kernel->index), "%eax");
+    emitInstruction("movslq %eax, %r9");
+    loadOperandToRegister(getOperandValue(kernel->limit), "%edx");
+    if (kernel->inclusive) emitInstruction("incl %edx");
+    emitInstruction("movslq %edx, %r8");
+    emitInstruction("subq %r9, %r8");
+    emitInstruction("jle " + skipLabel);
+
+    for (const auto& store : kernel->stores) {
+        const LaneNode& node = kernel->nodes[store.second];
+        emitInstruction("leaq " + getOperandLocation(store.first) + "(%rip), %rdi");
+        emitInstruction("leaq (%rdi,%r9,4), %rdi");
+        emitInstruction("movq %r8, %rcx");
+        if (node.operation == LaneOperation::LOAD) {
+            emitInstruction("leaq " + getOperandLocation(node.symbol) + "(%rip), %rsi");
+            emitInstruction("leaq (%rsi,%r9,4), %rsi");
+            emitInstruction("rep movsl");
+        } else {
+            loadOperandToRegister(getOperandValue(node.symbol), "%eax");
+            emitInstruction("rep stosl");
+        }
+    }
+    storeRegisterToOperand("%edx", getOperandLocation(kernel->index));
+    emitLabel(skipLabel + ":");
+}
+
+// Vectorized loop: runs as many iterations as fit in whole packed registers, the original loop does the rest
+void emitVectorLoop(TAC* current) {
+    const VectorKernel* kernel = getVectorKernel(current);
+    if (!kernel) return;
+    if (kernel->bulk) {
+        emitBulkLoop(kernel);
+        return;
+    }
+
+    int lanes = useAVX2 ? 8 : 4;
+    bool wide = useAVX2;
+    std::string prefix = useAVX2 ? "v" : "";
+    std::string bodyLabel = "vecloop_body_" + std::to_string(labelCounter++);
+    std::string skipLabel = "vecloop_skip_" + std::to_string(labelCounter++);
+    emitComment("Vectorized loop: " + kernel->index->getLexeme() + (kernel->inclusive ? " <= " : " < ") +
+                kernel->limit->getLexeme() + " (" + std::to_string(lanes) + " lanes)");
+
+    // Registers of the nodes that reach a store or reduction, then of the accumulators
+    std::vector<bool> needed(kernel->nodes.size(), false);
+    for (const auto& store : kernel->stores) needed[store.second] = true;
+    for (const VectorReduction& reduction : kernel->reductions) needed[reduction.node] = true;
+    for (size_t i = kernel->nodes.size(); i-- > 0;) {
+        if (!needed[i]) continue;
+        if (kernel->nodes[i].left >= 0) needed[kernel->nodes[i].left] = true;
+        if (kernel->nodes[i].right >= 0) needed[kernel->nodes[i].right] = true;
+    }
+    std::vector<int> registers(kernel->nodes.size(), -1);
+    int nextRegister = 0;
+    for (size_t i = 0; i < kernel->nodes.size(); i++) {
+        if (needed[i]) registers[i] = nextRegister++;
+    }
+    std::vector<int> accumulators;
+    for (size_t i = 0; i < kernel->reductions.size(); i++) {
+        accumulators.push_back(nextRegister++);
+    }
+
+    // Loop bounds: %rax = index, %rdx = index + (iterations rounded down to whole registers)
+    loadOperandToRegister(getOperandValue(kernel->index), "%eax");
+    emitInstruction("cltq");
+    loadOperandToRegister(getOperandValue(kernel->limit), "%edx");
+    if (kernel->inclusive) emitInstruction("incl %edx");
+    emitInstruction("movslq %edx, %rdx");
+    emitInstruction("movq %rdx, %rcx");
+    emitInstruction("subq %rax, %rcx");
+    emitInstruction("cmpq $" + std::to_string(lanes) + ", %rcx");
+    emitInstruction("jl " + skipLabel);
+    emitInstruction("andq $" + std::to_string(-lanes) + ", %rcx");
+    emitInstruction("leaq (%rax,%rcx), %rdx");
+
+    // Invariant values and the initial accumulators
+    for (size_t i = 0; i < kernel->nodes.size(); i++) {
+        if (needed[i] && kernel->nodes[i].operation == LaneOperation::BROADCAST) {
+            loadOperandToRegister(getOperandValue(kernel->nodes[i].symbol), "%ecx");
+            emitBroadcast(registers[i]);
+        }
+    }
+    for (size_t i = 0; i < kernel->reductions.size(); i++) {
+        const VectorReduction& reduction = kernel->reductions[i];
+        if (reduction.kind == ReductionKind::MAX || reduction.kind == ReductionKind::MIN) {
+            loadOperandToRegister(getOperandValue(reduction.accumulator), "%ecx");
+            emitBroadcast(accumulators[i]);
+        } else {
+            std::string accumulatorReg = vectorRegister(accumulators[i], wide);
+            emitInstruction(prefix + "pxor " + accumulatorReg + ", " + accumulatorReg + (useAVX2 ? ", " + accumulatorReg : ""));
+        }
+    }
+
+    // Base address of each vector
+    static const char* baseRegisters[] = {"%rsi", "%rdi", "%r8", "%r9", "%r10", "%r11"};
+    std::unordered_map<Symbol*, std::string> bases;
+    auto baseOf = [&](Symbol* vector) {
+        auto it = bases.find(vector);
+        if (it != bases.end()) return it->second;
+        std::string base = baseRegisters[bases.size()];
+        emitInstruction("leaq " + getOperandLocation(vector) + "(%rip), " + base);
+        bases[vector] = base;
+        return base;
+    };
+    for (size_t i = 0; i < kernel->nodes.size(); i++) {
+        if (needed[i] && kernel->nodes[i].operation == LaneOperation::LOAD) baseOf(kernel->nodes[i].symbol);
+    }
+    for (const auto& store : kernel->stores) baseOf(store.first);
+
+    emitLabel(bodyLabel + ":");
+    for (size_t i = 0; i < kernel->nodes.size(); i++) {
+        if (!needed[i]) continue;
+        const LaneNode& node = kernel->nodes[i];
+        int destination = registers[i];
+        std::string destinationReg = vectorRegister(destination, wide);
+        int left = node.left >= 0 ? registers[node.left] : -1;
+        int right = node.right >= 0 ? registers[node.right] : -1;
+
+        switch (node.operation) {
+            case LaneOperation::LOAD:
+                emitInstruction(prefix + "movdqu (" + bases[node.symbol] + ",%rax,4), " + destinationReg);
+                break;
+            case LaneOperation::ADD:
+                emitPackedOperation("paddd", left, right, destination, wide);
+                break;
+            case LaneOperation::SUB:
+                emitPackedOperation("psubd", left, right, destination, wide);
+                break;
+            case LaneOperation::MUL:
+                emitPackedMultiply(left, right, destination, wide);
+                break;
+            case LaneOperation::GT:
+            case LaneOperation::EQ: {
+                emitPackedOperation(node.operation == LaneOperation::GT ? "pcmpgtd" : "pcmpeqd", left, right, destination, wide);
+                if (node.inverted) {
+                    emitPackedOperation("pcmpeqd", VECTOR_SCRATCH, VECTOR_SCRATCH, VECTOR_SCRATCH, wide);
+                    emitPackedOperation("pxor", destination, VECTOR_SCRATCH, destination, wide);
+                }
+                // All-ones masks become 1
+                if (useAVX2) {
+                    emitInstruction("vpsrld $31, " + destinationReg + ", " + destinationReg);
+                } else {
+                    emitInstruction("psrld $31, " + destinationReg);
+                }
+                break;
+            }
+            case LaneOperation::SELECT:
+                // 0 - condition is an all-ones mask where the condition holds
+                emitPackedOperation("pxor", VECTOR_SCRATCH, VECTOR_SCRATCH, VECTOR_SCRATCH, wide);
+                emitPackedOperation("psubd", VECTOR_SCRATCH, left, VECTOR_SCRATCH, wide);
+                emitPackedOperation("pand", VECTOR_SCRATCH, right, destination, wide);
+                break;
+            default:
+                break;
+        }
+    }
+    for (const auto& store : kernel->stores) {
+        emitInstruction(prefix + "movdqu " + vectorRegister(registers[store.second], wide) + ", (" + bases[store.first] + ",%rax,4)");
+    }
+    for (size_t i = 0; i < kernel->reductions.size(); i++) {
+        const VectorReduction& reduction = kernel->reductions[i];
+        int value = registers[reduction.node];
+        switch (reduction.kind) {
+            case ReductionKind::SUM:
+                emitPackedOperation("paddd", accumulators[i], value, accumulators[i], wide);
+                break;
+            case ReductionKind::DIFFERENCE:
+                emitPackedOperation("psubd", accumulators[i], value, accumulators[i], wide);
+                break;
+            case ReductionKind::MAX:
+            case ReductionKind::MIN:
+                emitPackedMaxMin(accumulators[i], value, reduction.kind == ReductionKind::MAX, wide);
+                break;
+        }
+    }
+    emitInstruction("addq $" + std::to_string(lanes) + ", %rax");
+    emitInstruction("cmpq %rdx, %rax");
+    emitInstruction("jl " + bodyLabel);
+
+    // Write back the counter and the accumulators
+    storeRegisterToOperand("%eax", getOperandLocation(kernel->index));
+    for (size_t i = 0; i < kernel->reductions.size(); i++) {
+        const VectorReduction& reduction = kernel->reductions[i];
+        std::string accumulatorLoc = getOperandLocation(reduction.accumulator);
+        emitHorizontalReduction(accumulators[i], reduction.kind);
+        if (reduction.kind == ReductionKind::MAX || reduction.kind == ReductionKind::MIN) {
+            storeRegisterToOperand("%ecx", accumulatorLoc);
+        } else {
+            loadOperandToRegister(accumulatorLoc, "%r11d");
+            emitInstruction("addl %ecx, %r11d");
+            storeRegisterToOperand("%r11d", accumulatorLoc);
+        }
+    }
+    if (useAVX2) emitInstruction("vzeroupper");
+    emitLabel(skipLabel + ":");
+}
+
+// Helper function to find the comparisons whose only use is the IFZ or IFNZ right after them
+// Those are emitted as a single cmpl + conditional jump, without materializing the boolean
+void findFusedComparisons(TAC* tacHead) {
+    fusedComparisons.clear();
+    tailCalls.clear();
+    loopLabels.clear();
+    std::unordered_map<Symbol*, int> uses;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getOp1()) uses[tac->getOp1()]++;
+        if (tac->getOp2()) uses[tac->getOp2()]++;
+    }
+
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        switch (tac->getType()) {
+            case TACType::LT:
+            case TACType::GT:
+            case TACType::LE:
+            case TACType::GE:
+            case TACType::EQ:
+            case TACType::NE: {
+                TAC* next = tac->getNext();
+                Symbol* result = tac->getRes();
+                bool tested = next && (((next->getType() == TACType::IFZ || next->getType() == TACType::IFNZ) && next->getOp1() == result) ||
+                                       (next->getType() == TACType::SELECT && next->getOp2() == result));
+                if (tested && result->getIdentifierType() == identifierType::TEMP && uses[result] == 1) {
+                    fusedComparisons.insert(tac);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// Helper function to find the labels targeted by a jump placed after them (loop heads)
+void findLoopLabels(TAC* tacHead) {
+    loopLabels.clear();
+    std::set<Symbol*> seen;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() == TACType::LABEL) {
+            seen.insert(tac->getOp1());
+        } else if (tac->getType() == TACType::JUMP && seen.count(tac->getOp1())) {
+            loopLabels.insert(tac->getOp1());
+        } else if ((tac->getType() == TACType::IFZ || tac->getType() == TACType::IFNZ) && seen.count(tac->getOp2())) {
+            loopLabels.insert(tac->getOp2());
+        }
+    }
+}
+
+// Helper function to get the jump taken when a comparison is true
+std::string getComparisonJump(TACType type) {
+    switch (type) {
+        case TACType::LT: return "jl";
+        case TACType::GT: return "jg";
+        case TACType::LE: return "jle";
+        case TACType::GE: return "jge";
+        case TACType::EQ: return "je";
+        default: return "jne";
+    }
+}
+
+// Helper function to get the jump taken when a comparison is false
+std::string getInvertedJump(TACType type) {
+    switch (type) {
+        case TACType::LT: return "jge";
+        case TACType::GT: return "jle";
+        case TACType::LE: return "jg";
+        case TACType::GE: return "jl";
+        case TACType::EQ: return "jne";
+        default: return "je";
+    }
+}
+
+// Helper function to read the value of a numeric literal symbol without giving it a stack slot
+bool getLiteralValue(Symbol* symbol, int& value) {
+    if (!symbol) return false;
+    const std::string& text = symbol->getLexeme();
+    if (!std::isdigit(text[0]) && !(text[0] == '-' && text.length() > 1)) return false;
+    return getImmediateValue("$" + text, value);
+}
+
+// Helper function to find multiplications by 2, 4 or 8 whose only use is the addition right after them,
+// so that one lea computes both
+void findScaledAdditions(TAC* tacHead) {
+    scaledMultiplies.clear();
+    std::unordered_map<Symbol*, int> uses;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getOp1()) uses[tac->getOp1()]++;
+        if (tac->getOp2()) uses[tac->getOp2()]++;
+    }
+
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        TAC* next = tac->getNext();
+        Symbol* result = tac->getRes();
+        if (tac->getType() != TACType::MUL || !next || next->getType() != TACType::ADD ||
+            result->getIdentifierType() != identifierType::TEMP || uses[result] != 1 ||
+            (next->getOp1() != result && next->getOp2() != result) || next->getOp1() == next->getOp2()) {
+            continue;
+        }
+        int left = 0;
+        int right = 0;
+        bool leftConstant = getLiteralValue(tac->getOp1(), left);
+        bool rightConstant = getLiteralValue(tac->getOp2(), right);
+        int scale = rightConstant ? right : left;
+        if (leftConstant != rightConstant && (scale == 2 || scale == 4 || scale == 8)) {
+            scaledMultiplies.insert(tac);
+        }
+    }
+}
+
+// Helper function to check if an instruction only computes its result, so that prints may move past it
+bool isPrintIndependent(TAC* tac, const std::vector<Symbol*>& printed) {
+    switch (tac->getType()) {
+        case TACType::MOVE:
+        case TACType::ADD:
+        case TACType::SUB:
+        case TACType::MUL:
+        case TACType::DIV:
+        case TACType::MOD:
+        case TACType::AND:
+        case TACType::OR:
+        case TACType::NOT:
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE:
+        case TACType::VECREAD:
+            return std::find(printed.begin(), printed.end(), tac->getRes()) == printed.end();
+        default:
+            return false;
+    }
+}
+
+// Helper function to merge runs of PRINT instructions, written at the last PRINT of the run
+// String literals and constants between two variables become a single string, printed with one runtime call.
+// Instructions computing the values of the next items (such as "print a " " b * 2") may sit between the PRINTs
+void findPrintGroups(TAC* tacHead) {
+    printGroups.clear();
+    fusedPrints.clear();
+    int printsMerged = 0;
+
+    TAC* tac = tacHead;
+    while (tac) {
+        if (tac->getType() != TACType::PRINT) {
+            tac = tac->getNext();
+            continue;
+        }
+
+        std::vector<TAC*> prints;
+        PrintGroup group;
+        std::string text;
+        TAC* resume = tac->getNext();
+        for (; tac; tac = tac->getNext()) {
+            if (tac->getType() != TACType::PRINT) {
+                if (!isPrintIndependent(tac, group.values)) break;
+                continue;
+            }
+
+            Symbol* symbol = tac->getOp1();
+            const std::string& lexeme = symbol->getLexeme();
+            int value = 0;
+            if (lexeme.size() >= 2 && lexeme.front() == '"' && lexeme.back() == '"') {
+                text += lexeme.substr(1, lexeme.size() - 2);
+            } else if (lexeme.size() == 3 && lexeme.front() == '\'' && lexeme.back() == '\'') {
+                text += std::to_string((int)lexeme[1]);
+            } else if (getLiteralValue(symbol, value)) {
+                text += std::to_string(value);
+            } else {
+                group.texts.push_back(text.empty() ? "" : getStringLabel("\"" + text + "\""));
+                group.values.push_back(symbol);
+                text.clear();
+            }
+            prints.push_back(tac);
+            resume = tac->getNext();
+        }
+        tac = resume;
+
+        if (prints.size() > 1) {
+            group.texts.push_back(text.empty() ? "" : getStringLabel("\"" + text + "\""));
+            printGroups[prints.back()] = group;
+            fusedPrints.insert(prints.begin(), prints.end() - 1);
+            printsMerged += static_cast<int>(prints.size());
+        }
+    }
+
+    std::cout << "Print fusion completed: " << printsMerged << " print instructions merged into " << printGroups.size()
+              << " runs." << std::endl;
+}
+
+// Helper function to write an operand value as an instruction operand: immediate, stack slot or RIP-relative global
+std::string getOperandReference(const std::string& value) {
+    if (value[0] == '$' || isStackLocation(value)) return value;
+    return value + "(%rip)";
+}
+
+// Helper function to address element index of a global vector, index being a constant
+std::string getElementReference(const std::string& vector, long long index) {
+    long long offset = index * 4;
+    if (offset == 0) return vector + "(%rip)";
+    return vector + (offset > 0 ? "+" : "") + std::to_string(offset) + "(%rip)";
+}
+
+// Operands of the instruction being covered, as values ("$N", stack slot or global name)
+struct TileOperands {
+    TAC* tac;
+    std::string result;     // Destination (vector for VECWRITE)
+    std::string left;       // First source (vector for VECREAD, index for VECWRITE)
+    std::string right;      // Second source
+    std::string index;      // Operand scaled by the multiplication folded into an addition, if any
+    int scale;
+};
+
+// One way of covering a TAC pattern with x86-64 instructions
+struct InstructionTile {
+    const char* pattern;
+    int cost;                                   // Instructions emitted
+    bool (*matches)(const TileOperands&);
+    void (*emit)(const TileOperands&);
+};
+
+bool isImmediate(const std::string& value) {
+    return value[0] == '$';
+}
+
+// Helper function to load an operand into %rax as a sign-extended index
+void loadIndexToRegister(const std::string& index) {
+    emitInstruction("movslq " + getOperandReference(index) + ", %rax");
+}
+
+// Tiles of every instruction the selector handles; the cheapest matching tile is emitted
+const std::vector<InstructionTile>& getInstructionTiles(TACType type) {
+    static const std::vector<InstructionTile> none;
+    static const std::vector<InstructionTile> addTiles = {
+        {"x = x + 1", 1,
+         [](const TileOperands& t) { return t.index.empty() && ((t.result == t.left && t.right == "$1") || (t.result == t.right && t.left == "$1")); },
+         [](const TileOperands& t) { emitInstruction("incl " + getOperandReference(t.result)); }},
+        {"x = x + k", 1,
+         [](const TileOperands& t) { return t.index.empty() && ((t.result == t.left && isImmediate(t.right)) || (t.result == t.right && isImmediate(t.left))); },
+         [](const TileOperands& t) {
+             const std::string& constant = t.result == t.left ? t.right : t.left;
+             emitInstruction("addl " + constant + ", " + getOperandReference(t.result));
+         }},
+        {"x = x + y", 2,
+         [](const TileOperands& t) { return t.index.empty() && (t.result == t.left || t.result == t.right); },
+         [](const TileOperands& t) {
+             const std::string& other = t.result == t.left ? t.right : t.left;
+             loadOperandToRegister(other, "%eax");
+             emitInstruction("addl %eax, " + getOperandReference(t.result));
+         }},
+        {"r = a + b * s", 4,
+         [](const TileOperands& t) { return !t.index.empty(); },
+         [](const TileOperands& t) {
+             loadOperandToRegister(t.left, "%eax");
+             loadOperandToRegister(t.index, "%ecx");
+             emitInstruction("leal (%rax,%rcx," + std::to_string(t.scale) + "), %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }},
+        {"r = a + b", 3,
+         [](const TileOperands& t) { return t.index.empty(); },
+         [](const TileOperands& t) {
+             // An immediate goes last, where addl takes it directly
+             bool swap = isImmediate(t.left) && !isImmediate(t.right);
+             loadOperandToRegister(swap ? t.right : t.left, "%eax");
+             emitInstruction("addl " + getOperandReference(swap ? t.left : t.right) + ", %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }}
+    };
+    static const std::vector<InstructionTile> subTiles = {
+        {"x = x - 1", 1,
+         [](const TileOperands& t) { return t.result == t.left && t.right == "$1"; },
+         [](const TileOperands& t) { emitInstruction("decl " + getOperandReference(t.result)); }},
+        {"x = x - k", 1,
+         [](const TileOperands& t) { return t.result == t.left && isImmediate(t.right); },
+         [](const TileOperands& t) { emitInstruction("subl " + t.right + ", " + getOperandReference(t.result)); }},
+        {"x = x - y", 2,
+         [](const TileOperands& t) { return t.result == t.left; },
+         [](const TileOperands& t) {
+             loadOperandToRegister(t.right, "%eax");
+             emitInstruction("subl %eax, " + getOperandReference(t.result));
+         }},
+        {"r = a - b", 3,
+         [](const TileOperands&) { return true; },
+         [](const TileOperands& t) {
+             loadOperandToRegister(t.left, "%eax");
+             emitInstruction("subl " + getOperandReference(t.right) + ", %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }}
+    };
+    static const std::vector<InstructionTile> mulTiles = {
+        {"r = a * k", 3,
+         [](const TileOperands& t) { return isImmediate(t.left) != isImmediate(t.right); },
+         [](const TileOperands& t) {
+             int constant = 0;
+             bool right = getImmediateValue(t.right, constant);
+             if (!right) getImmediateValue(t.left, constant);
+             loadOperandToRegister(right ? t.left : t.right, "%eax");
+             emitMultiplyByConstant(constant);
+             storeRegisterToOperand("%eax", t.result);
+         }},
+        {"r = a * b", 3,
+         [](const TileOperands&) { return true; },
+         [](const TileOperands& t) {
+             loadOperandToRegister(t.left, "%eax");
+             emitInstruction("imull " + getOperandReference(t.right) + ", %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }}
+    };
+    static const std::vector<InstructionTile> compareTiles = {
+        {"r = x cmp k", 4,
+         [](const TileOperands& t) { return !isImmediate(t.left) && isImmediate(t.right); },
+         [](const TileOperands& t) {
+             emitInstruction("cmpl " + t.right + ", " + getOperandReference(t.left));
+             emitInstruction("set" + getComparisonJump(t.tac->getType()).substr(1) + " %al");
+             emitInstruction("movzbl %al, %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }},
+        {"r = a cmp b", 5,
+         [](const TileOperands&) { return true; },
+         [](const TileOperands& t) {
+             loadOperandToRegister(t.left, "%eax");
+             emitInstruction("cmpl " + getOperandReference(t.right) + ", %eax");
+             emitInstruction("set" + getComparisonJump(t.tac->getType()).substr(1) + " %al");
+             emitInstruction("movzbl %al, %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }}
+    };
+    // Branches on a fused comparison: left and right come from the comparison, result is the label
+    static const std::vector<InstructionTile> branchTiles = {
+        {"if x cmp k", 2,
+         [](const TileOperands& t) { return !t.right.empty() && !isImmediate(t.left) && isImmediate(t.right); },
+         [](const TileOperands& t) {
+             TAC* comparison = t.tac->getPrev();
+             emitInstruction("cmpl " + t.right + ", " + getOperandReference(t.left));
+             emitInstruction((t.tac->getType() == TACType::IFZ ? getInvertedJump(comparison->getType())
+                                                                 : getComparisonJump(comparison->getType())) + " " + t.result);
+         }},
+        {"if a cmp b", 3,
+         [](const TileOperands& t) { return !t.right.empty(); },
+         [](const TileOperands& t) {
+             TAC* comparison = t.tac->getPrev();
+             loadOperandToRegister(t.left, "%eax");
+             emitInstruction("cmpl " + getOperandReference(t.right) + ", %eax");
+             emitInstruction((t.tac->getType() == TACType::IFZ ? getInvertedJump(comparison->getType())
+                                                                 : getComparisonJump(comparison->getType())) + " " + t.result);
+         }},
+        {"if x", 2,
+         [](const TileOperands& t) { return t.right.empty() && !isImmediate(t.left); },
+         [](const TileOperands& t) {
+             emitInstruction("cmpl $0, " + getOperandReference(t.left));
+             emitInstruction((t.tac->getType() == TACType::IFZ ? "je " : "jne ") + t.result);
+         }}
+    };
+    static const std::vector<InstructionTile> readTiles = {
+        {"r = v[k]", 2,
+         [](const TileOperands& t) { return !isStackLocation(t.left) && isImmediate(t.right); },
+         [](const TileOperands& t) {
+             int index = 0;
+             getImmediateValue(t.right, index);
+             emitInstruction("movl " + getElementReference(t.left, index) + ", %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }},
+        {"r = v[i]", 4,
+         [](const TileOperands& t) { return !isStackLocation(t.left); },
+         [](const TileOperands& t) {
+             loadIndexToRegister(t.right);
+             emitInstruction("leaq " + t.left + "(%rip), %rcx");
+             emitInstruction("movl (%rcx,%rax,4), %eax");
+             storeRegisterToOperand("%eax", t.result);
+         }}
+    };
+    static const std::vector<InstructionTile> writeTiles = {
+        {"v[k] = c", 1,
+         [](const TileOperands& t) { return !isStackLocation(t.result) && isImmediate(t.left) && isImmediate(t.right); },
+         [](const TileOperands& t) {
+             int index = 0;
+             getImmediateValue(t.left, index);
+             emitInstruction("movl " + t.right + ", " + getElementReference(t.result, index));
+         }},
+        {"v[k] = x", 2,
+         [](const TileOperands& t) { return !isStackLocation(t.result) && isImmediate(t.left); },
+         [](const TileOperands& t) {
+             int index = 0;
+             getImmediateValue(t.left, index);
+             loadOperandToRegister(t.right, "%edx");
+             emitInstruction("movl %edx, " + getElementReference(t.result, index));
+         }},
+        {"v[i] = x", 4,
+         [](const TileOperands& t) { return !isStackLocation(t.result); },
+         [](const TileOperands& t) {
+             std::string value = t.right;
+             if (!isImmediate(value)) {
+                 loadOperandToRegister(value, "%edx");
+                 value = "%edx";
+             }
+             loadIndexToRegister(t.left);
+             emitInstruction("leaq " + t.result + "(%rip), %rcx");
+             emitInstruction("movl " + value + ", (%rcx,%rax,4)");
+         }}
+    };
+
+    switch (type) {
+        case TACType::ADD: return addTiles;
+        case TACType::SUB: return subTiles;
+        case TACType::MUL: return mulTiles;
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE: return compareTiles;
+        case TACType::IFZ:
+        case TACType::IFNZ: return branchTiles;
+        case TACType::VECREAD: return readTiles;
+        case TACType::VECWRITE: return writeTiles;
+        default: return none;
+    }
+}
+
+// Helper function to cover an instruction with the cheapest matching tile (optimized code only)
+// source is the fused comparison of a branch, whose operands the branch tests; returns false if no tile applies
+bool selectInstruction(TAC* tac, TAC* source) {
+    TileOperands operands;
+    operands.tac = tac;
+    operands.scale = 0;
+    switch (tac->getType()) {
+        case TACType::IFZ:
+        case TACType::IFNZ:
+            operands.result = tac->getOp2()->getLexeme();
+            operands.left = getOperandValue(source ? source->getOp1() : tac->getOp1());
+            if (source) operands.right = getOperandValue(source->getOp2());
+            break;
+        case TACType::VECREAD:
+            operands.result = getOperandLocation(tac->getRes());
+            operands.left = getOperandLocation(tac->getOp1());
+            operands.right = getOperandValue(tac->getOp2());
+            break;
+        case TACType::VECWRITE:
+            operands.result = getOperandLocation(tac->getRes());
+            operands.left = getOperandValue(tac->getOp1());
+            operands.right = getOperandValue(tac->getOp2());
+            break;
+        default: {
+            operands.result = getOperandLocation(tac->getRes());
+            operands.left = getOperandValue(tac->getOp1());
+            operands.right = getOperandValue(tac->getOp2());
+            // The scaled operand replaces the temp of the multiplication folded into this addition
+            TAC* previous = tac->getPrev();
+            if (previous && scaledMultiplies.count(previous)) {
+                int scale = 0;
+                bool rightConstant = getLiteralValue(previous->getOp2(), scale);
+                if (!rightConstant) getLiteralValue(previous->getOp1(), scale);
+                operands.index = getOperandValue(rightConstant ? previous->getOp1() : previous->getOp2());
+                operands.scale = scale;
+                if (tac->getOp1() == previous->getRes()) operands.left = operands.right;
+                operands.right.clear();
+            }
+            break;
+        }
+    }
+
+    const InstructionTile* best = nullptr;
+    for (const InstructionTile& tile : getInstructionTiles(tac->getType())) {
+        if (!tile.matches(operands)) continue;
+        if (!best || tile.cost < best->cost) best = &tile;
+    }
+    if (!best) return false;
+    emitComment("Tile: " + std::string(best->pattern));
+    best->emit(operands);
+    return true;
+}
+
+// Live range of a local in the instruction order of its function
+struct FrameSlot {
+    Symbol* symbol;
+    int start;
+    int end;
+    int size;
+    TAC* argument;                      // ARG whose copy the slot keeps (symbol is then nullptr)
+};
+
+// Helper function to check whether a symbol needs a stack slot (locals only: globals, literals and labels do not)
+bool isFrameOperand(Symbol* symbol) {
+    if (!symbol || varLocations.count(symbol->getLexeme())) return false;
+    identifierType kind = symbol->getIdentifierType();
+    if (kind == identifierType::LITERAL || kind == identifierType::LABEL ||
+        kind == identifierType::FUNCTION || kind == identifierType::VECTOR) {
+        return false;
+    }
+    char first = symbol->getLexeme()[0];
+    return !std::isdigit(first) && first != '-' && first != '\'' && first != '"';
+}
+
+// Helper function to check whether the value of an ARG may change before the CALL that consumes it: an instruction
+// in between writes its operand, or calls a function that may write it (a global)
+bool isArgumentChanged(TAC* argument, TAC* call) {
+    Symbol* symbol = argument->getOp1();
+    if (!symbol || symbol->getIdentifierType() == identifierType::LITERAL) return false;
+    bool global = !isFrameOperand(symbol);
+    for (TAC* tac = argument->getNext(); tac && tac != call; tac = tac->getNext()) {
+        if (tac->getRes() == symbol) return true;
+        if (global && (tac->getType() == TACType::CALL || tac->getType() == TACType::READ)) return true;
+    }
+    return false;
+}
+
+// Helper function to collect the symbols an instruction keeps in memory once lowered
+std::vector<Symbol*> getFrameOperands(TAC* tac) {
+    switch (tac->getType()) {
+        case TACType::LABEL:
+        case TACType::JUMP:
+        case TACType::BEGINFUN:
+        case TACType::ENDFUN:
+        case TACType::BEGINVEC:
+        case TACType::ENDVEC:
+        case TACType::INIT:
+            return {};
+        case TACType::IFZ:
+        case TACType::IFNZ: {
+            // A fused comparison never stores the boolean the branch tests
+            TAC* previous = tac->getPrev();
+            if (previous && fusedComparisons.count(previous)) return {previous->getOp1(), previous->getOp2()};
+            return {tac->getOp1()};
+        }
+        case TACType::CALL:
+            return {tac->getRes()};
+        case TACType::JUMPTABLE:
+            return {tac->getOp1()};
+        case TACType::PRINT: {
+            // Merged prints read every value of their run at the last PRINT
+            if (fusedPrints.count(tac)) return {};
+            auto group = printGroups.find(tac);
+            if (group != printGroups.end()) return group->second.values;
+            return {tac->getOp1()};
+        }
+        case TACType::SELECT: {
+            TAC* previous = tac->getPrev();
+            if (previous && fusedComparisons.count(previous)) return {tac->getRes(), tac->getOp1(), previous->getOp1(), previous->getOp2()};
+            return {tac->getRes(), tac->getOp1(), tac->getOp2()};
+        }
+        case TACType::VECREAD:
+            return {tac->getRes(), tac->getOp2()};
+        case TACType::VECWRITE:
+            return {tac->getOp1(), tac->getOp2()};
+        case TACType::VECLOOP: {
+            std::vector<Symbol*> operands = getVectorKernelOperands(tac);
+            operands.push_back(tac->getRes());
+            operands.push_back(tac->getOp1());
+            operands.push_back(tac->getOp2());
+            return operands;
+        }
+        default: {
+            if (fusedComparisons.count(tac) || scaledMultiplies.count(tac)) return {};
+            TAC* previous = tac->getPrev();
+            if (previous && scaledMultiplies.count(previous)) {
+                Symbol* other = tac->getOp1() == previous->getRes() ? tac->getOp2() : tac->getOp1();
+                return {tac->getRes(), other, previous->getOp1(), previous->getOp2()};
+            }
+            return {tac->getRes(), tac->getOp1(), tac->getOp2()};
+        }
+    }
+}
+
+// Helper function to give every local of the function made of [first, last) its stack slot before emission
+// Temps whose live ranges do not overlap share a slot, and leaf functions whose slots fit in the red zone
+// run without a frame. Returns the number of bytes the prologue must reserve
+int planFrame(TAC* first, TAC* last) {
+    std::vector<FrameSlot> slots;
+    std::unordered_map<Symbol*, size_t> slotOf;
+    std::unordered_map<Symbol*, int> labelPosition;
+    std::vector<std::pair<int, Symbol*>> branches;
+    std::vector<std::pair<TAC*, int>> arguments;
+    bool hasCall = false;
+
+    int position = 0;
+    for (TAC* tac = first; tac && tac != last; tac = tac->getNext(), position++) {
+        TACType type = tac->getType();
+        if (type == TACType::CALL || type == TACType::PRINT || type == TACType::READ) hasCall = true;
+        if (type == TACType::LABEL) labelPosition[tac->getOp1()] = position;
+        if (type == TACType::JUMP) branches.push_back({position, tac->getOp1()});
+        if (type == TACType::IFZ || type == TACType::IFNZ) branches.push_back({position, tac->getOp2()});
+        if (type == TACType::JUMPTABLE) {
+            for (Symbol* target : getJumpTableTargets(tac)) {
+                branches.push_back({position, target});
+            }
+        }
+
+        // ARGs are matched with their CALL like the emission does; a value that may change in between is copied
+        // at the ARG into a slot that lives until the CALL, any other one is read by the CALL and lives until it
+        if (type == TACType::ARG) arguments.push_back({tac, position});
+        if (type == TACType::CALL) {
+            size_t count = std::min(getFunctionParameters(tac->getOp1()).size(), arguments.size());
+            for (size_t i = arguments.size() - count; i < arguments.size(); i++) {
+                TAC* argument = arguments[i].first;
+                if (isArgumentChanged(argument, tac)) {
+                    slots.push_back({nullptr, arguments[i].second, position, 4, argument});
+                    continue;
+                }
+                auto it = slotOf.find(argument->getOp1());
+                if (it != slotOf.end()) slots[it->second].end = position;
+            }
+            arguments.resize(arguments.size() - count);
+        }
+
+        for (Symbol* symbol : getFrameOperands(tac)) {
+            if (!isFrameOperand(symbol)) continue;
+            auto it = slotOf.find(symbol);
+            if (it != slotOf.end()) {
+                slots[it->second].end = position;
+                continue;
+            }
+            bool pointer = symbol->getIdentifierType() == identifierType::TEMP && symbol->getDataType() == dataType::ADDRESS;
+            slotOf[symbol] = slots.size();
+            slots.push_back({symbol, position, position, pointer ? 8 : 4, nullptr});
+        }
+    }
+
+    // Parameters live for the whole function; a value live anywhere in a loop lives through all of it
+    for (FrameSlot& slot : slots) {
+        if (slot.symbol && slot.symbol->getIdentifierType() != identifierType::TEMP) {
+            slot.start = 0;
+            slot.end = position;
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& branch : branches) {
+            auto target = labelPosition.find(branch.second);
+            if (target == labelPosition.end() || target->second > branch.first) continue;
+            int head = target->second;
+            int tail = branch.first;
+            for (FrameSlot& slot : slots) {
+                if (slot.start > tail || slot.end < head) continue;
+                if (slot.start > head || slot.end < tail) {
+                    slot.start = std::min(slot.start, head);
+                    slot.end = std::max(slot.end, tail);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Linear scan over the live ranges, reusing the offsets of ranges that already ended
+    std::vector<size_t> order(slots.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&slots](size_t a, size_t b) { return slots[a].start < slots[b].start; });
+
+    std::vector<int> offsets(slots.size(), 0);
+    std::vector<size_t> active;
+    std::unordered_map<int, std::vector<int>> freeOffsets;
+    int frameBytes = 0;
+    for (size_t index : order) {
+        FrameSlot& slot = slots[index];
+        if (optimizeCode) {
+            for (size_t i = 0; i < active.size();) {
+                if (slots[active[i]].end < slot.start) {
+                    freeOffsets[slots[active[i]].size].push_back(offsets[active[i]]);
+                    active.erase(active.begin() + (long)i);
+                } else {
+                    i++;
+                }
+            }
+        }
+        std::vector<int>& reusable = freeOffsets[slot.size];
+        if (!reusable.empty()) {
+            offsets[index] = reusable.back();
+            reusable.pop_back();
+        } else {
+            frameBytes = (frameBytes + slot.size - 1) / slot.size * slot.size; // Keep the slot naturally aligned
+            frameBytes += slot.size;
+            offsets[index] = frameBytes;
+        }
+        active.push_back(index);
+    }
+
+    framelessFunction = optimizeCode && !hasCall && frameBytes <= RED_ZONE_SIZE;
+    std::string base = framelessFunction ? "(%rsp)" : "(%rbp)";
+    for (size_t i = 0; i < slots.size(); i++) {
+        std::string location = "-" + std::to_string(offsets[i]) + base;
+        if (slots[i].argument) {
+            argumentCopies[slots[i].argument] = location;
+        } else {
+            varLocations[slots[i].symbol->getLexeme()] = location;
+        }
+    }
+    stackOffset = frameBytes;
+
+    // Keep %rsp 16-byte aligned for the calls made by the function
+    return framelessFunction ? 0 : (frameBytes + 15) / 16 * 16;
+}
+
+// Helper function to emit the entry of a function whose body is [first, last), after planning its frame
+void emitPrologue(const std::string& name, TAC* first, TAC* last) {
+    emitLabel(name + ":");
+    int frameSize = planFrame(first, last);
+    if (framelessFunction) {
+        emitComment("Function " + name + " prologue (leaf, no frame)");
+        return;
+    }
+    emitComment("Function " + name + " prologue");
+    emitInstruction("pushq %rbp");
+    emitInstruction("movq %rsp, %rbp");
+    if (frameSize > 0) {
+        emitInstruction("subq $" + std::to_string(frameSize) + ", %rsp");
+    }
+}
+
+// Helper function to emit the exit every return of the current function jumps to
+void emitEpilogue(const std::string& name) {
+    emitLabel(".L" + name + "_epilogue:");
+    emitComment("Function " + name + " epilogue");
+    if (!framelessFunction) {
+        emitInstruction("movq %rbp, %rsp");
+        emitInstruction("popq %rbp");
+    }
+    emitInstruction("ret");
+    (*outFile) << std::endl;
+}
+
 std::string getStringLabel(const std::string& str) {
     // Find existing string or add new one
     auto it = std::find(stringLiterals.begin(), stringLiterals.end(), str);
@@ -190,16 +1387,31 @@ void emitComment(const std::string& comment) {
     (*outFile) << "\t# " << comment << std::endl;
 }
 
-// Public interface function
-void generateASM(TAC* tacHead, const std::string& outputFileName) {
-    std::ofstream file(outputFileName);
-    if (!file) {
-        std::cerr << "Error: Could not open output file " << outputFileName << std::endl;
+// Helper function to encode the final assembly into an ELF object next to its file (name.s -> name.o)
+void emitObjectFile(const std::vector<std::string>& lines, const std::string& assemblyFileName) {
+    std::string objectFileName = assemblyFileName;
+    if (objectFileName.size() > 2 && objectFileName.compare(objectFileName.size() - 2, 2, ".s") == 0) {
+        objectFileName.erase(objectFileName.size() - 2);
+    }
+    objectFileName += ".o";
+
+    // A stale object of an earlier run must not be linked instead of the assembly file
+    ObjectCode code;
+    std::string error;
+    if (!assembleObject(lines, code, error) || !writeObjectFile(code, objectFileName)) {
+        std::remove(objectFileName.c_str());
+        std::cerr << "- Object file not written (" << (error.empty() ? "could not open " + objectFileName : error)
+                  << "), assemble \"" << assemblyFileName << "\" instead." << std::endl;
         return;
     }
-    
+    std::cerr << "- Object file saved to file \"" << objectFileName << "\"." << std::endl;
+}
+
+// Public interface function
+std::vector<std::string> generateASMLines(TAC* tacHead, bool optimize, bool avx2, bool freestanding) {
     // Initialize global state
-    outFile = &file;
+    std::ostringstream buffer;
+    outFile = &buffer;
     varLocations.clear();
     vectorSizes.clear();
     stringLiterals.clear();
@@ -208,19 +1420,35 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
     stringCounter = 0;
     currentRegister = "%rax";
     currentFunction = "";
-    functionParamCount.clear();
-    currentParamOffset = 16;
+    currentParamIndex = 0;
+    pendingArguments.clear();
+    argumentCopies.clear();
+    optimizeCode = optimize;
+    useAVX2 = avx2;
+    freestandingProgram = freestanding;
+    fusedComparisons.clear();
+    scaledMultiplies.clear();
+    printGroups.clear();
+    fusedPrints.clear();
+    framelessFunction = false;
     
     // Check if TAC exists
     if (!tacHead) {
-        file.close();
-        return;
+        outFile = nullptr;
+        return std::vector<std::string>();
     }
     
     emitHeader("Generated x86 Assembly Code from 2025++1 code");
     emitHeader("Compiler made by Nathan Guimaraes (334437)");
     (*outFile) << std::endl;
     
+    if (optimizeCode) {
+        findFusedComparisons(tacHead);
+        findLoopLabels(tacHead);
+        findScaledAdditions(tacHead);
+        findPrintGroups(tacHead);
+    }
+
     // Process in the same order as printTAC function
     // Start from the end and work backwards
     TAC* current = tacHead;
@@ -255,8 +1483,9 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
             std::string value = current->getOp1()->getLexeme();
             globalVars.push_back({varName, value});
         }
-        // Check for string literals in PRINT and other operations
-        if (current->getType() == TACType::PRINT && current->getOp1()) {
+        // Check for string literals in PRINT and other operations (merged prints use their own format)
+        if (current->getType() == TACType::PRINT && current->getOp1() && !printGroups.count(current) &&
+            !fusedPrints.count(current)) {
             std::string value = current->getOp1()->getLexeme();
             if (value.front() == '"' && value.back() == '"') {
                 getStringLabel(value); // This will add it to stringLiterals if not already there
@@ -267,12 +1496,6 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
     
     // Generate data section
     emitLabel(".section .data");
-    emitInstruction("int_format: .string \"%d\"");
-    emitInstruction("char_format: .string \"%c\"");
-    emitInstruction("string_format: .string \"%s\"");
-    emitInstruction("newline: .string \"\\n\"");
-    emitInstruction("scanf_int: .string \"%d\"");
-    emitInstruction("scanf_char: .string \" %c\"");
     
     // Global variables
     for (const auto& var : globalVars) {
@@ -337,9 +1560,22 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
     // Generate text section
     emitLabel(".section .text");
     emitLabel(".globl main");
-    emitLabel(".extern printf");
-    emitLabel(".extern scanf");
+    emitLabel(".extern runtimePrintInt");
+    emitLabel(".extern runtimePrintString");
+    emitLabel(".extern runtimeReadInt");
     (*outFile) << std::endl;
+
+    // Without libc the program starts at _start: the kernel leaves %rsp 16-byte aligned, so calling main keeps the ABI
+    if (freestandingProgram) {
+        emitLabel(".globl _start");
+        emitLabel(".extern runtimeExit");
+        emitLabel("_start:");
+        emitInstruction("xorl %ebp, %ebp");
+        emitInstruction("call main");
+        emitInstruction("movl %eax, %edi");
+        emitInstruction("call runtimeExit");
+        (*outFile) << std::endl;
+    }
     
     // Process TAC instructions, but organize them properly
     // First pass: collect function definitions and global initializations
@@ -413,30 +1649,13 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
         current = current->getNext();
     }
     
-    // Generate main function
-    emitLabel("main:");
-    emitComment("Function main prologue");
-    emitInstruction("pushq %rbp");
-    emitInstruction("movq %rsp, %rbp");
-    
-    // Allocate space for temporary variables only (vectors are now global)
-    // Skip INIT variables and vectors since they're now global
-    for (TAC* tac : globalInits) {
-        // Only process non-INIT, non-vector instructions that might need temp variables
-        if (tac->getType() != TACType::INIT && tac->getType() != TACType::BEGINVEC && tac->getType() != TACType::ENDVEC) {
-            // This will allocate temp variables as needed during processing
-        }
-    }
-    for (TAC* tac : mainInstructions) {
-        // Only process instructions that might need temp variables
-        if (tac->getType() != TACType::INIT && tac->getType() != TACType::BEGINVEC && tac->getType() != TACType::ENDVEC) {
-            // This will allocate temp variables as needed during processing
-        }
-    }
-    
-    // Subtract stack space for local variables (vectors and temporary variables)
-    if (stackOffset > 0) {
-        emitInstruction("subq $" + std::to_string(stackOffset) + ", %rsp");
+    // Generate main function, with its frame planned before any instruction uses it
+    currentFunction = "main";
+    stackOffset = 0;
+    if (mainInstructions.empty()) {
+        emitPrologue("main", nullptr, nullptr);
+    } else {
+        emitPrologue("main", mainInstructions.front(), mainInstructions.back()->getNext());
     }
     
     // Process global initializations (now inside main)
@@ -450,11 +1669,7 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
     }
     
     // Main function epilogue
-    emitComment("Function main epilogue");
-    emitInstruction("movq %rbp, %rsp");
-    emitInstruction("popq %rbp");
-    emitInstruction("ret");
-    (*outFile) << std::endl;
+    emitEpilogue("main");
     
     // Process other functions
     for (TAC* tac : functionInstructions) {
@@ -465,12 +1680,47 @@ void generateASM(TAC* tacHead, const std::string& outputFileName) {
     (*outFile) << std::endl;
     emitLabel(".section .note.GNU-stack,\"\",@progbits");
     
+    // The optimized assembly goes through the peephole optimizer before being written
+    std::vector<std::string> lines;
+    std::istringstream input(buffer.str());
+    std::string line;
+    while (std::getline(input, line)) {
+        lines.push_back(line);
+    }
+    if (optimizeCode) {
+        lines = optimizePeephole(lines);
+    }
+    outFile = nullptr;
+    return lines;
+}
+
+// Public interface function
+void generateASM(TAC* tacHead, const std::string& outputFileName, bool optimize, bool avx2, bool freestanding,
+                 bool object) {
+    std::ofstream file(outputFileName);
+    if (!file) {
+        std::cerr << "Error: Could not open output file " << outputFileName << std::endl;
+        return;
+    }
+
+    std::vector<std::string> lines = generateASMLines(tacHead, optimize, avx2, freestanding);
+    for (const std::string& text : lines) {
+        file << text << std::endl;
+    }
     file.close();
+
+    // With --object the same lines are encoded in process, the assembly file stays as a listing
+    if (object) {
+        emitObjectFile(lines, outputFileName);
+    }
 }
 
 void processInstruction(TAC* current) {
     if (!current) return;
     
+    // Fused comparisons are emitted by the IFZ that uses them, scaled multiplications by the addition after them
+    if (fusedComparisons.count(current) || scaledMultiplies.count(current)) return;
+    
     switch (current->getType()) {
             case TACType::INIT: {
                 // INIT instructions are now handled in the data section
@@ -484,7 +1734,7 @@ void processInstruction(TAC* current) {
                 emitComment("Move " + src + " to " + dest);
                 if (src[0] == '$') {
                     // Check if destination is a global variable
-                    if (destLoc.find("(%rbp)") == std::string::npos) {
+                    if (!isStackLocation(destLoc)) {
                         // Global variable - use PIE-compatible store
                         emitInstruction("movl " + src + ", " + destLoc + "(%rip)");
                     } else {
@@ -493,7 +1743,7 @@ void processInstruction(TAC* current) {
                     }
                 } else {
                     // Check if source is a global variable
-                    if (src.find("(%rbp)") == std::string::npos) {
+                    if (!isStackLocation(src)) {
                         // Global variable - use PIE-compatible load
                         emitInstruction("movl " + src + "(%rip), %eax");
                     } else {
@@ -501,7 +1751,7 @@ void processInstruction(TAC* current) {
                         emitInstruction("movl " + src + ", %eax");
                     }
                     // Check if destination is a global variable
-                    if (destLoc.find("(%rbp)") == std::string::npos) {
+                    if (!isStackLocation(destLoc)) {
                         // Global variable - use PIE-compatible store
                         emitInstruction("movl %eax, " + destLoc + "(%rip)");
                     } else {
@@ -511,108 +1761,107 @@ void processInstruction(TAC* current) {
                 }
                 break;
             }
+            case TACType::SELECT: {
+                // Both values are loaded and cmov keeps one of them, without a branch
+                std::string result = current->getRes()->getLexeme();
+                std::string resultLoc = getOperandLocation(current->getRes());
+                std::string value = getOperandValue(current->getOp1());
+                std::string condition = getOperandValue(current->getOp2());
+                emitComment("Select: " + result + " = " + value + " if " + current->getOp2()->getLexeme());
+                loadOperandToRegister(value, "%ecx");
+                loadOperandToRegister(resultLoc, "%edx");
+                std::string move = "cmovne";
+                TAC* comparison = current->getPrev();
+                if (comparison && fusedComparisons.count(comparison)) {
+                    loadOperandToRegister(getOperandValue(comparison->getOp1()), "%eax");
+                    emitInstruction("cmpl " + getOperandReference(getOperandValue(comparison->getOp2())) + ", %eax");
+                    move = "cmov" + getComparisonJump(comparison->getType()).substr(1);
+                } else {
+                    loadOperandToRegister(condition, "%eax");
+                    emitInstruction("cmpl $0, %eax");
+                }
+                emitInstruction(move + " %ecx, %edx");
+                storeRegisterToOperand("%edx", resultLoc);
+                break;
+            }
             case TACType::PRINT: {
+                if (fusedPrints.count(current)) break;
+                auto group = printGroups.find(current);
+                if (group != printGroups.end()) {
+                    const PrintGroup& run = group->second;
+                    emitComment("Print a run of " + std::to_string(run.values.size()) + " values and their text");
+                    for (size_t i = 0; i < run.texts.size(); i++) {
+                        if (!run.texts[i].empty()) {
+                            emitInstruction("leaq " + run.texts[i] + "(%rip), %rdi");
+                            emitInstruction("call runtimePrintString");
+                        }
+                        if (i < run.values.size()) {
+                            loadOperandToRegister(getOperandValue(run.values[i]), "%edi");
+                            emitInstruction("call runtimePrintInt");
+                        }
+                    }
+                    break;
+                }
                 std::string value = getOperandValue(current->getOp1());
                 emitComment("Print " + value);
-                std::string format = "int_format";
                 
-                // Integer or string printing
+                // Strings and integers go to the buffered output of the runtime (runtime.c), first argument in %rdi
                 if (value.front() == '"' && value.back() == '"') {
-                    format = "string_format";
-                    value = getStringLabel(value);
-                }
-                // In 64-bit System V ABI, first argument goes in %rdi, second in %rsi
-                if (value[0] == '$') {
-                    // Remove $ prefix and use PIE-compatible addressing
-                    std::string cleanValue = value.substr(1);
-                    emitInstruction("leaq " + cleanValue + "(%rip), %rsi");
+                    emitInstruction("leaq " + getStringLabel(value) + "(%rip), %rdi");
+                    emitInstruction("call runtimePrintString");
                 } else {
-                    // Check if it's a global variable (no %rbp reference)
-                    if (value.find("(%rbp)") == std::string::npos && value[0] != '$') {
-                        // Check if it's a string literal or an integer variable
-                        if (value.find("str_") == 0) {
-                            // String literal - use address
-                            emitInstruction("leaq " + value + "(%rip), %rsi");
-                        } else {
-                            // Global variable value - use PIE-compatible load
-                            emitInstruction("movl " + value + "(%rip), %esi");
-                        }
-                    } else {
-                        // Stack variable or immediate value
-                        emitInstruction("movl " + value + ", %esi");
-                    }
+                    loadOperandToRegister(value, "%edi");
+                    emitInstruction("call runtimePrintInt");
                 }
-                emitInstruction("leaq " + format + "(%rip), %rdi");
-                emitInstruction("call printf@PLT");
                 break;
             }
             case TACType::BEGINFUN: {
                 std::string funcName = current->getOp1()->getLexeme();
                 currentFunction = funcName;
-                currentParamOffset = 16; // Reset parameter offset (16 in 64-bit due to return address + %rbp)
-                emitLabel(funcName + ":");
-                emitComment("Function " + funcName + " prologue");
-                emitInstruction("pushq %rbp");
-                emitInstruction("movq %rsp, %rbp");
+                currentParamIndex = 0;
                 stackOffset = 0; // Reset local variable offset
                 
-                // For user-defined functions (not main), move register arguments to stack
-                if (funcName != "main") {
-                    // Look ahead to see what parameters this function has
-                    TAC* nextTAC = current->getNext();
-                    int paramCount = 0;
-                    while (nextTAC && nextTAC->getType() != TACType::ENDFUN) {
-                        // Count operations that use parameters (typically first operations in function)
-                        if (nextTAC->getType() == TACType::ADD || nextTAC->getType() == TACType::SUB ||
-                            nextTAC->getType() == TACType::MUL || nextTAC->getType() == TACType::DIV ||
-                            nextTAC->getType() == TACType::MOD) {
-                            // If using parameter symbols, allocate and move from registers
-                            if (nextTAC->getOp1() && paramCount < 2) {
-                                std::string param1Name = nextTAC->getOp1()->getLexeme();
-                                if (varLocations.find(param1Name) == varLocations.end()) {
-                                    std::string paramLoc = allocateParameter(param1Name);
-                                    if (paramCount == 0) {
-                                        emitInstruction("movl %edi, " + paramLoc);
-                                    } else if (paramCount == 1) {
-                                        emitInstruction("movl %esi, " + paramLoc);
-                                    }
-                                    paramCount++;
-                                }
-                            }
-                            if (nextTAC->getOp2() && paramCount < 2) {
-                                std::string param2Name = nextTAC->getOp2()->getLexeme();
-                                if (varLocations.find(param2Name) == varLocations.end()) {
-                                    std::string paramLoc = allocateParameter(param2Name);
-                                    if (paramCount == 0) {
-                                        emitInstruction("movl %edi, " + paramLoc);
-                                    } else if (paramCount == 1) {
-                                        emitInstruction("movl %esi, " + paramLoc);
-                                    }
-                                    paramCount++;
-                                }
-                            }
-                            break; // Only process first operation to get parameters
-                        }
-                        nextTAC = nextTAC->getNext();
-                    }
+                // Plan the frame for the locals of the function body
+                TAC* endTAC = current->getNext();
+                while (endTAC && endTAC->getType() != TACType::ENDFUN) {
+                    endTAC = endTAC->getNext();
+                }
+                emitPrologue(funcName, current->getNext(), endTAC);
+                break;
+            }
+            case TACType::PARAM: {
+                // System V ABI: the first six arguments come in registers, the others above the return address
+                static const char* parameterRegisters[] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+                std::string paramLoc = getOperandLocation(current->getRes());
+                emitComment("Parameter " + current->getRes()->getLexeme());
+                if (currentParamIndex < 6) {
+                    emitInstruction("movl " + std::string(parameterRegisters[currentParamIndex]) + ", " + paramLoc);
+                } else {
+                    // Without a frame, only the return address sits between %rsp and the stack arguments
+                    int offset = (framelessFunction ? 8 : 16) + 8 * (currentParamIndex - 6);
+                    emitInstruction("movl " + std::to_string(offset) + (framelessFunction ? "(%rsp)" : "(%rbp)") + ", %eax");
+                    emitInstruction("movl %eax, " + paramLoc);
                 }
+                currentParamIndex++;
                 break;
             }
             case TACType::ENDFUN: {
-                std::string funcName = current->getOp1()->getLexeme();
-                emitComment("Function " + funcName + " epilogue");
-                emitInstruction("movq %rbp, %rsp");
-                emitInstruction("popq %rbp");
-                emitInstruction("ret");
-                (*outFile) << std::endl;
+                emitEpilogue(current->getOp1()->getLexeme());
                 break;
             }
             case TACType::RET: {
+                // The callee of a tail call already returned to our caller
+                if (tailCalls.count(current)) break;
                 if (current->getOp1()) {
                     std::string retVal = getOperandValue(current->getOp1());
                     emitComment("Return " + retVal);
                     loadOperandToRegister(retVal, "%eax");
                 }
+                // Leave through the epilogue unless it comes right after
+                TAC* next = current->getNext();
+                if (!next || next->getType() != TACType::ENDFUN) {
+                    emitInstruction("jmp .L" + currentFunction + "_epilogue");
+                }
                 break;
             }
             case TACType::ADD: {
@@ -623,6 +1872,7 @@ void processInstruction(TAC* current) {
                 
                 // Integer addition
                 emitComment("Add: " + result + " = " + op1 + " + " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("addl %ebx, %eax");
@@ -637,6 +1887,7 @@ void processInstruction(TAC* current) {
                 
                 // Integer subtraction
                 emitComment("Subtract: " + result + " = " + op1 + " - " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("subl %ebx, %eax");
@@ -649,9 +1900,19 @@ void processInstruction(TAC* current) {
                 std::string op2 = getOperandValue(current->getOp2());
                 std::string resultLoc = allocateVariable(result);
                 emitComment("Multiply: " + result + " = " + op1 + " * " + op2);
-                loadOperandToRegister(op1, "%eax");
-                loadOperandToRegister(op2, "%ebx");
-                emitInstruction("imull %ebx, %eax");
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
+                int constant = 0;
+                if (optimizeCode && getImmediateValue(op2, constant)) {
+                    loadOperandToRegister(op1, "%eax");
+                    emitMultiplyByConstant(constant);
+                } else if (optimizeCode && getImmediateValue(op1, constant)) {
+                    loadOperandToRegister(op2, "%eax");
+                    emitMultiplyByConstant(constant);
+                } else {
+                    loadOperandToRegister(op1, "%eax");
+                    loadOperandToRegister(op2, "%ebx");
+                    emitInstruction("imull %ebx, %eax");
+                }
                 storeRegisterToOperand("%eax", resultLoc);
                 break;
             }
@@ -662,9 +1923,15 @@ void processInstruction(TAC* current) {
                 std::string resultLoc = allocateVariable(result);
                 emitComment("Divide: " + result + " = " + op1 + " / " + op2);
                 loadOperandToRegister(op1, "%eax");
-                emitInstruction("cdq"); // Sign extend %eax to %edx:%eax
-                loadOperandToRegister(op2, "%ebx");
-                emitInstruction("idivl %ebx");
+                int divisor = 0;
+                if (optimizeCode && getImmediateValue(op2, divisor) && divisor != 0 && divisor != 1 &&
+                    divisor != -1 && divisor != INT32_MIN) {
+                    emitDivideByConstant(divisor);
+                } else {
+                    emitInstruction("cdq"); // Sign extend %eax to %edx:%eax
+                    loadOperandToRegister(op2, "%ebx");
+                    emitInstruction("idivl %ebx");
+                }
                 storeRegisterToOperand("%eax", resultLoc);
                 break;
             }
@@ -675,10 +1942,17 @@ void processInstruction(TAC* current) {
                 std::string resultLoc = allocateVariable(result);
                 emitComment("Modulo: " + result + " = " + op1 + " % " + op2);
                 loadOperandToRegister(op1, "%eax");
-                emitInstruction("cdq"); // Sign extend %eax to %edx:%eax
-                loadOperandToRegister(op2, "%ebx");
-                emitInstruction("idivl %ebx");
-                storeRegisterToOperand("%edx", resultLoc); // Remainder is in %edx
+                int divisor = 0;
+                if (optimizeCode && getImmediateValue(op2, divisor) && divisor != 0 && divisor != 1 &&
+                    divisor != -1 && divisor != INT32_MIN) {
+                    emitModuloByConstant(divisor);
+                    storeRegisterToOperand("%eax", resultLoc);
+                } else {
+                    emitInstruction("cdq"); // Sign extend %eax to %edx:%eax
+                    loadOperandToRegister(op2, "%ebx");
+                    emitInstruction("idivl %ebx");
+                    storeRegisterToOperand("%edx", resultLoc); // Remainder is in %edx
+                }
                 break;
             }
             case TACType::LT: {
@@ -689,6 +1963,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "lt_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "lt_end_" + std::to_string(labelCounter++);
                 emitComment("Less than: " + result + " = " + op1 + " < " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -710,6 +1985,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "eq_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "eq_end_" + std::to_string(labelCounter++);
                 emitComment("Equal: " + result + " = " + op1 + " == " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -731,6 +2007,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "ne_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "ne_end_" + std::to_string(labelCounter++);
                 emitComment("Not Equal: " + result + " = " + op1 + " != " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -752,6 +2029,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "gt_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "gt_end_" + std::to_string(labelCounter++);
                 emitComment("Greater than: " + result + " = " + op1 + " > " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -773,6 +2051,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "le_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "le_end_" + std::to_string(labelCounter++);
                 emitComment("Less or Equal: " + result + " = " + op1 + " <= " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -794,6 +2073,7 @@ void processInstruction(TAC* current) {
                 std::string trueLabel = "ge_true_" + std::to_string(labelCounter++);
                 std::string endLabel = "ge_end_" + std::to_string(labelCounter++);
                 emitComment("Greater or Equal: " + result + " = " + op1 + " >= " + op2);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(op1, "%eax");
                 loadOperandToRegister(op2, "%ebx");
                 emitInstruction("cmpl %ebx, %eax");
@@ -888,6 +2168,10 @@ void processInstruction(TAC* current) {
             }
             case TACType::LABEL: {
                 std::string label = current->getOp1()->getLexeme();
+                // Loop heads start on a 16-byte boundary, padding is only executed when entering the loop
+                if (loopLabels.count(current->getOp1())) {
+                    emitInstruction(".p2align 4");
+                }
                 emitLabel(label + ":");
                 break;
             }
@@ -896,13 +2180,66 @@ void processInstruction(TAC* current) {
                 emitInstruction("jmp " + label);
                 break;
             }
-            case TACType::IFZ: {
+            case TACType::JUMPTABLE: {
+                const JumpTable* table = getJumpTable(current);
+                std::string value = getOperandValue(current->getOp1());
+                std::string defaultLabel = current->getOp2()->getLexeme();
+                std::string tableLabel = "jumptable_" + std::to_string(labelCounter++);
+                int high = table->low + (int)table->targets.size() - 1;
+                emitComment("Jump table on " + value + " for " + std::to_string(table->low) + " to " +
+                            std::to_string(high) + ", other values go to " + defaultLabel);
+
+                // One unsigned compare checks both bounds: values below the lowest case wrap around to large numbers
+                loadOperandToRegister(value, "%eax");
+                if (table->low != 0) {
+                    emitInstruction("subl $" + std::to_string(table->low) + ", %eax");
+                }
+                emitInstruction("cmpl $" + std::to_string(table->targets.size() - 1) + ", %eax");
+                emitInstruction("ja " + defaultLabel);
+
+                // Entries hold the distance from the table to each label, so the code stays position independent
+                emitInstruction("leaq " + tableLabel + "(%rip), %rdx");
+                emitInstruction("movslq (%rdx,%rax,4), %rax");
+                emitInstruction("addq %rdx, %rax");
+                emitInstruction("jmp *%rax");
+                emitLabel(".section .rodata");
+                emitInstruction(".p2align 2");
+                emitLabel(tableLabel + ":");
+                for (Symbol* target : table->targets) {
+                    emitInstruction(".long " + target->getLexeme() + " - " + tableLabel);
+                }
+                emitLabel(".section .text");
+                break;
+            }
+            case TACType::IFZ:
+            case TACType::IFNZ: {
+                bool jumpIfZero = current->getType() == TACType::IFZ;
+                TAC* comparison = current->getPrev();
+                if (comparison && fusedComparisons.count(comparison)) {
+                    if (selectInstruction(current, comparison)) break;
+                    std::string op1 = getOperandValue(comparison->getOp1());
+                    std::string op2 = getOperandValue(comparison->getOp2());
+                    std::string label = current->getOp2()->getLexeme();
+                    emitComment("Compare " + op1 + " with " + op2 + " and jump to " + label +
+                                (jumpIfZero ? " if false" : " if true"));
+                    loadOperandToRegister(op1, "%eax");
+                    if (op2[0] == '$') {
+                        emitInstruction("cmpl " + op2 + ", %eax");
+                    } else {
+                        loadOperandToRegister(op2, "%ebx");
+                        emitInstruction("cmpl %ebx, %eax");
+                    }
+                    std::string jump = jumpIfZero ? getInvertedJump(comparison->getType()) : getComparisonJump(comparison->getType());
+                    emitInstruction(jump + " " + label);
+                    break;
+                }
                 std::string condition = getOperandValue(current->getOp1());
                 std::string label = current->getOp2()->getLexeme();
-                emitComment("Jump if zero to " + label);
+                emitComment((jumpIfZero ? "Jump if zero to " : "Jump if not zero to ") + label);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 loadOperandToRegister(condition, "%eax");
                 emitInstruction("cmpl $0, %eax");
-                emitInstruction("je " + label);
+                emitInstruction((jumpIfZero ? "je " : "jne ") + label);
                 break;
             }
             case TACType::CALL: {
@@ -910,43 +2247,41 @@ void processInstruction(TAC* current) {
                 std::string funcName = current->getOp1()->getLexeme();
                 emitComment("Call function " + funcName);
                 
-                // Collect the ARG instructions before this CALL
-                std::vector<std::string> args;
-                TAC* temp = current->getPrev();
-                while (temp && temp->getType() == TACType::ARG) {
-                    std::string arg = getOperandValue(temp->getOp1());
-                    args.push_back(arg);
-                    temp = temp->getPrev();
-                }
-                
-                // Reverse args to get correct order (first arg in args[0])
-                std::reverse(args.begin(), args.end());
+                // The arguments of this call are the last ARGs not taken by a nested call
+                size_t count = std::min(getFunctionParameters(current->getOp1()).size(), pendingArguments.size());
+                std::vector<std::string> args(pendingArguments.end() - count, pendingArguments.end());
+                pendingArguments.resize(pendingArguments.size() - count);
                 
-                // Skip string arguments for user-defined functions (these are for print formatting)
-                std::vector<std::string> functionArgs;
-                for (const std::string& arg : args) {
-                    if (!(arg.front() == '"' && arg.back() == '"')) {
-                        functionArgs.push_back(arg);
-                    }
+                // Arguments past the sixth go on the stack, last one pushed first, keeping %rsp 16-byte aligned
+                static const char* argumentRegisters[] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+                int stackArguments = args.size() > 6 ? (int)args.size() - 6 : 0;
+                int stackBytes = 8 * stackArguments + (stackArguments % 2) * 8;
+                if (stackArguments % 2) {
+                    emitInstruction("subq $8, %rsp");
+                }
+                for (size_t i = args.size(); i-- > 6;) {
+                    loadOperandToRegister(args[i], "%eax");
+                    emitInstruction("pushq %rax");
+                }
+                for (size_t i = 0; i < args.size() && i < 6; i++) {
+                    loadOperandToRegister(args[i], argumentRegisters[i]);
                 }
                 
-                // Pass arguments via registers for user-defined functions
-                if (funcName != "printf" && funcName != "scanf") {
-                    if (functionArgs.size() >= 1) {
-                        loadOperandToRegister(functionArgs[0], "%edi");
-                    }
-                    if (functionArgs.size() >= 2) {
-                        loadOperandToRegister(functionArgs[1], "%esi");
-                    }
-                    // For more than 2 args, we'd need %edx, %ecx, etc.
+                // A call whose result is returned right away reuses the frame of the caller: leave it and jump
+                TAC* next = current->getNext();
+                if (optimizeCode && stackArguments == 0 && next && next->getType() == TACType::RET &&
+                    next->getOp1() == current->getRes()) {
+                    emitComment("Tail call to " + funcName);
+                    emitInstruction("movq %rbp, %rsp");
+                    emitInstruction("popq %rbp");
+                    emitInstruction("jmp " + funcName);
+                    tailCalls.insert(next);
+                    break;
                 }
                 
-                // For external functions, use PLT
-                if (funcName == "printf" || funcName == "scanf") {
-                    emitInstruction("call " + funcName + "@PLT");
-                } else {
-                    // For internal functions, direct call
-                    emitInstruction("call " + funcName);
+                emitInstruction("call " + funcName);
+                if (stackBytes > 0) {
+                    emitInstruction("addq $" + std::to_string(stackBytes) + ", %rsp");
                 }
                 
                 if (!result.empty()) {
@@ -956,27 +2291,25 @@ void processInstruction(TAC* current) {
                 break;
             }
             case TACType::ARG: {
-                // In 64-bit System V ABI, arguments are passed in registers
-                // (%rdi, %rsi, %rdx, %rcx, %r8, %r9), then on stack
-                // For simplicity, collect arguments and pass them when CALL happens
+                // Passed when the CALL that consumes it is reached, from a copy made now when the value may change before
+                std::string value = getOperandValue(current->getOp1());
+                auto copy = argumentCopies.find(current);
+                if (copy != argumentCopies.end()) {
+                    emitComment("Copy argument " + current->getOp1()->getLexeme());
+                    loadOperandToRegister(value, "%eax");
+                    storeRegisterToOperand("%eax", copy->second);
+                    value = copy->second;
+                }
+                pendingArguments.push_back(value);
                 break;
             }
             case TACType::READ: {
                 std::string var = current->getRes()->getLexeme();
                 std::string varLoc = getOperandLocation(current->getRes());
                 emitComment("Read into " + var);
-                // In 64-bit System V ABI, first argument goes in %rdi, second in %rsi
-                // For global variables, we need the address (using PIE-compatible addressing)
-                // For stack variables, we need to use lea to get address
-                if (varLoc.find("(%rbp)") == std::string::npos) {
-                    // Global variable - use PIE-compatible addressing
-                    emitInstruction("leaq " + varLoc + "(%rip), %rsi");
-                } else {
-                    // Stack variable - use lea to get effective address
-                    emitInstruction("leaq " + varLoc + ", %rsi");
-                }
-                emitInstruction("leaq scanf_int(%rip), %rdi");
-                emitInstruction("call scanf@PLT");
+                // The runtime parses the next integer of its input buffer (runtime.c) and returns it in %eax
+                emitInstruction("call runtimeReadInt");
+                storeRegisterToOperand("%eax", varLoc);
                 break;
             }
             case TACType::VECWRITE: {
@@ -984,6 +2317,7 @@ void processInstruction(TAC* current) {
                 std::string index = getOperandValue(current->getOp1());
                 std::string value = getOperandValue(current->getOp2());
                 emitComment("Vector write: " + vecName + "[" + index + "] = " + value);
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 std::string vecLoc = getOperandLocation(current->getRes());
                 
                 // Load index using PIE-compatible method
@@ -993,7 +2327,7 @@ void processInstruction(TAC* current) {
                 loadOperandToRegister(value, "%ebx");
                 
                 // For global vectors, use PIE-compatible addressing
-                if (vecLoc.find("(%rbp)") == std::string::npos) {
+                if (!isStackLocation(vecLoc)) {
                     // Global vector - use PIE-compatible addressing with index
                     emitInstruction("leaq " + vecLoc + "(%rip), %rcx");
                     emitInstruction("movl %ebx, (%rcx,%rax)");
@@ -1013,13 +2347,14 @@ void processInstruction(TAC* current) {
                 std::string resultLoc = allocateVariable(result);
                 std::string vecLoc = getOperandLocation(current->getOp1());
                 emitComment("Vector read: " + result + " = " + vecName + "[" + index + "]");
+                if (optimizeCode && selectInstruction(current, nullptr)) break;
                 
                 // Load index using PIE-compatible method
                 loadOperandToRegister(index, "%eax");
                 emitInstruction("imull $4, %eax"); // 4 bytes per element for int values
                 
                 // For global vectors, use PIE-compatible addressing
-                if (vecLoc.find("(%rbp)") == std::string::npos) {
+                if (!isStackLocation(vecLoc)) {
                     // Global vector - use PIE-compatible addressing with index
                     emitInstruction("leaq " + vecLoc + "(%rip), %rcx");
                     emitInstruction("movl (%rcx,%rax), %ebx");
@@ -1030,7 +2365,59 @@ void processInstruction(TAC* current) {
                     std::string reg = vecLoc.substr(parenPos + 1, vecLoc.length() - parenPos - 2);
                     emitInstruction("movl " + offset + "(" + reg + ",%eax), %ebx");
                 }
-                emitInstruction("movl %ebx, " + resultLoc);
+                storeRegisterToOperand("%ebx", resultLoc);
+                break;
+            }
+            case TACType::VECADDR: {
+                std::string pointer = current->getRes()->getLexeme();
+                std::string vecName = current->getOp1()->getLexeme();
+                std::string index = getOperandValue(current->getOp2());
+                std::string pointerLoc = getOperandLocation(current->getRes());
+                std::string vecLoc = getOperandLocation(current->getOp1());
+                emitComment("Vector address: " + pointer + " = &" + vecName + "[" + index + "]");
+                loadOperandToRegister(index, "%eax");
+                emitInstruction("cltq"); // Sign extend the index to 64 bits
+                emitInstruction("leaq " + vecLoc + "(%rip), %rcx");
+                emitInstruction("leaq (%rcx,%rax,4), %rcx");
+                emitInstruction("movq %rcx, " + pointerLoc);
+                break;
+            }
+            case TACType::PTRREAD: {
+                std::string result = current->getRes()->getLexeme();
+                std::string pointerLoc = getOperandLocation(current->getOp1());
+                std::string resultLoc = allocateVariable(result);
+                emitComment("Pointer read: " + result + " = *" + current->getOp1()->getLexeme());
+                emitInstruction("movq " + pointerLoc + ", %rcx");
+                emitInstruction("movl (%rcx), %eax");
+                storeRegisterToOperand("%eax", resultLoc);
+                break;
+            }
+            case TACType::PTRWRITE: {
+                std::string pointerLoc = getOperandLocation(current->getRes());
+                std::string value = getOperandValue(current->getOp1());
+                emitComment("Pointer write: *" + current->getRes()->getLexeme() + " = " + value);
+                emitInstruction("movq " + pointerLoc + ", %rcx");
+                loadOperandToRegister(value, "%eax");
+                emitInstruction("movl %eax, (%rcx)");
+                break;
+            }
+            case TACType::PTRADD: {
+                std::string pointerLoc = getOperandLocation(current->getRes());
+                std::string sourceLoc = getOperandLocation(current->getOp1());
+                int elements = std::stoi(current->getOp2()->getLexeme());
+                std::string bytes = "$" + std::to_string(elements * 4);
+                emitComment("Pointer advance: " + current->getRes()->getLexeme() + " += " + std::to_string(elements) + " elements");
+                if (pointerLoc == sourceLoc) {
+                    emitInstruction("addq " + bytes + ", " + pointerLoc);
+                } else {
+                    emitInstruction("movq " + sourceLoc + ", %rcx");
+                    emitInstruction("addq " + bytes + ", %rcx");
+                    emitInstruction("movq %rcx, " + pointerLoc);
+                }
+                break;
+            }
+            case TACType::VECLOOP: {
+                emitVectorLoop(current);
                 break;
             }
             case TACType::BEGINVEC: {
@@ -5,9 +5,14 @@
 #define ASM_HPP
 
 #include <string>
+#include <vector>
 
 class TAC;
 
-void generateASM(TAC* tacHead, const std::string& outputFileName);
+void generateASM(TAC* tacHead, const std::string& outputFileName, bool optimize = false, bool avx2 = false,
+                 bool freestanding = false, bool object = false);
+// Lines of the assembly that generateASM writes, for the in-process encoder of --run
+std::vector<std::string> generateASMLines(TAC* tacHead, bool optimize = false, bool avx2 = false,
+                                          bool freestanding = false);
 
 #endif // ASM_HPP
\ No newline at end of file
@@ -0,0 +1,416 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Control flow graph (CFG) implementation file made by Nathan Alonso Guimarães (00334437)
+
+#include "cfg.hpp"
+#include "tac.hpp"
+#include "symbol.hpp"
+#include "vectorizer.hpp"
+#include "jumptable.hpp"
+#include <algorithm>
+
+// Helper function to check if an instruction ends a basic block
+bool isBlockTerminator(TAC* tac) {
+    if (!tac) return false;
+
+    return tac->getType() == TACType::IFZ ||
+           tac->getType() == TACType::IFNZ ||
+           tac->getType() == TACType::JUMP ||
+           tac->getType() == TACType::JUMPTABLE ||
+           tac->getType() == TACType::RET;
+}
+
+bool isVariableSymbol(Symbol* symbol) {
+    if (!symbol) return false;
+
+    return symbol->getIdentifierType() == identifierType::TEMP ||
+           symbol->getIdentifierType() == identifierType::VARIABLE ||
+           symbol->getIdentifierType() == identifierType::VECTOR;
+}
+
+std::vector<Symbol*> getUsedSymbols(TAC* tac) {
+    std::vector<Symbol*> used;
+    if (!tac) return used;
+
+    switch (tac->getType()) {
+        case TACType::MOVE:
+        case TACType::NOT:
+        case TACType::IFZ:
+        case TACType::IFNZ:
+        case TACType::JUMPTABLE:
+        case TACType::RET:
+        case TACType::PRINT:
+        case TACType::ARG:
+        case TACType::PTRREAD:
+        case TACType::PTRADD:
+            used.push_back(tac->getOp1());
+            break;
+        case TACType::PTRWRITE:
+            used.push_back(tac->getRes());
+            used.push_back(tac->getOp1());
+            break;
+        case TACType::ADD:
+        case TACType::SUB:
+        case TACType::MUL:
+        case TACType::DIV:
+        case TACType::MOD:
+        case TACType::AND:
+        case TACType::OR:
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE:
+        case TACType::VECREAD:
+        case TACType::VECADDR:
+            used.push_back(tac->getOp1());
+            used.push_back(tac->getOp2());
+            break;
+        case TACType::VECWRITE:
+        case TACType::SELECT:
+            // Writing one element keeps the rest of the vector, so the vector itself is also used
+            // (a select may keep the previous value of its result as well)
+            used.push_back(tac->getRes());
+            used.push_back(tac->getOp1());
+            used.push_back(tac->getOp2());
+            break;
+        case TACType::VECLOOP:
+            used = getVectorKernelOperands(tac);
+            break;
+        default:
+            break;
+    }
+
+    std::vector<Symbol*> variables;
+    for (Symbol* symbol : used) {
+        if (isVariableSymbol(symbol)) {
+            variables.push_back(symbol);
+        }
+    }
+    return variables;
+}
+
+Symbol* getDefinedSymbol(TAC* tac) {
+    if (!tac) return nullptr;
+
+    switch (tac->getType()) {
+        case TACType::MOVE:
+        case TACType::SELECT:
+        case TACType::ADD:
+        case TACType::SUB:
+        case TACType::MUL:
+        case TACType::DIV:
+        case TACType::MOD:
+        case TACType::AND:
+        case TACType::OR:
+        case TACType::NOT:
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE:
+        case TACType::VECREAD:
+        case TACType::CALL:
+        case TACType::READ:
+        case TACType::PARAM:
+        case TACType::VECADDR:
+        case TACType::PTRREAD:
+        case TACType::PTRADD:
+            return isVariableSymbol(tac->getRes()) ? tac->getRes() : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+void updateLiveness(TAC* tac, const FunctionCFG& cfg, std::set<Symbol*>& live) {
+    Symbol* defined = getDefinedSymbol(tac);
+    if (defined) {
+        live.erase(defined);
+    }
+    for (Symbol* used : getUsedSymbols(tac)) {
+        live.insert(used);
+    }
+
+    // The callee may read any global, and returning exposes them all to the caller
+    if (tac->getType() == TACType::CALL || tac->getType() == TACType::RET) {
+        live.insert(cfg.globals.begin(), cfg.globals.end());
+    }
+}
+
+Liveness computeLiveness(const FunctionCFG& cfg) {
+    Liveness liveness;
+    size_t blockCount = cfg.blocks.size();
+    liveness.liveIn.assign(blockCount, std::set<Symbol*>());
+    liveness.liveOut.assign(blockCount, std::set<Symbol*>());
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = blockCount; i-- > 0;) {
+            const BasicBlock& block = cfg.blocks[i];
+
+            // Blocks that leave the function keep every global alive
+            std::set<Symbol*> live;
+            if (block.successors.empty()) {
+                live = cfg.globals;
+            }
+            for (int successor : block.successors) {
+                live.insert(liveness.liveIn[successor].begin(), liveness.liveIn[successor].end());
+            }
+            liveness.liveOut[i] = live;
+
+            for (size_t j = block.instructions.size(); j-- > 0;) {
+                updateLiveness(block.instructions[j], cfg, live);
+            }
+            if (live != liveness.liveIn[i]) {
+                liveness.liveIn[i] = live;
+                changed = true;
+            }
+        }
+    }
+
+    return liveness;
+}
+
+std::vector<std::vector<bool>> computeDominators(const FunctionCFG& cfg) {
+    size_t blockCount = cfg.blocks.size();
+    std::vector<std::vector<bool>> dominators(blockCount, std::vector<bool>(blockCount, true));
+    if (blockCount == 0) return dominators;
+
+    // Unreachable blocks keep "dominated by everything", reachable ones shrink to their real dominators
+    dominators[0].assign(blockCount, false);
+    dominators[0][0] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < blockCount; i++) {
+            std::vector<bool> current(blockCount, true);
+            for (int predecessor : cfg.blocks[i].predecessors) {
+                for (size_t d = 0; d < blockCount; d++) {
+                    current[d] = current[d] && dominators[predecessor][d];
+                }
+            }
+            current[i] = true;
+            if (current != dominators[i]) {
+                dominators[i] = current;
+                changed = true;
+            }
+        }
+    }
+
+    return dominators;
+}
+
+// Helper function to find the blocks that can be reached from the entry block
+std::vector<bool> findReachableBlocks(const FunctionCFG& cfg) {
+    std::vector<bool> reachable(cfg.blocks.size(), false);
+    if (cfg.blocks.empty()) return reachable;
+
+    std::vector<int> pending(1, 0);
+    reachable[0] = true;
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        for (int successor : cfg.blocks[current].successors) {
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                pending.push_back(successor);
+            }
+        }
+    }
+    return reachable;
+}
+
+std::vector<NaturalLoop> findNaturalLoops(const FunctionCFG& cfg, const std::vector<std::vector<bool>>& dominators) {
+    std::vector<NaturalLoop> loops;
+    std::vector<bool> reachable = findReachableBlocks(cfg);
+
+    for (const BasicBlock& block : cfg.blocks) {
+        for (int successor : block.successors) {
+            // A back edge goes to a block that dominates its source
+            if (!reachable[block.id] || !dominators[block.id][successor]) continue;
+
+            NaturalLoop* loop = nullptr;
+            for (NaturalLoop& existing : loops) {
+                if (existing.header == successor) loop = &existing;
+            }
+            if (!loop) {
+                NaturalLoop created;
+                created.header = successor;
+                created.blocks.insert(successor);
+                loops.push_back(created);
+                loop = &loops.back();
+            }
+
+            // Walk backwards from the source of the back edge until the header
+            std::vector<int> pending;
+            if (loop->blocks.insert(block.id).second) pending.push_back(block.id);
+            while (!pending.empty()) {
+                int current = pending.back();
+                pending.pop_back();
+                for (int predecessor : cfg.blocks[current].predecessors) {
+                    if (reachable[predecessor] && loop->blocks.insert(predecessor).second) pending.push_back(predecessor);
+                }
+            }
+        }
+    }
+
+    std::stable_sort(loops.begin(), loops.end(), [](const NaturalLoop& a, const NaturalLoop& b) {
+        return a.blocks.size() < b.blocks.size();
+    });
+    return loops;
+}
+
+TAC* findPreheaderPosition(const FunctionCFG& cfg, const NaturalLoop& loop) {
+    const BasicBlock& header = cfg.blocks[loop.header];
+    TAC* headerLabel = header.instructions.front();
+    if (headerLabel->getType() != TACType::LABEL) return nullptr;
+
+    // The preheader goes right before the header label, so no loop block may fall through into it
+    bool hasEntry = loop.header == 0; // The entry block is also entered from the start of the function
+    for (int predecessor : header.predecessors) {
+        TAC* last = cfg.blocks[predecessor].instructions.back();
+        bool fallsThrough = predecessor == loop.header - 1 && last->getType() != TACType::JUMP;
+        if (loop.blocks.count(predecessor)) {
+            if (fallsThrough) return nullptr;
+        } else {
+            hasEntry = true;
+        }
+    }
+
+    return hasEntry ? headerLabel : nullptr;
+}
+
+void insertPreheader(const FunctionCFG& cfg, const NaturalLoop& loop, const std::vector<TAC*>& instructions) {
+    const BasicBlock& header = cfg.blocks[loop.header];
+    TAC* headerLabel = header.instructions.front();
+
+    // Outside predecessors that jump to the header must enter through the preheader instead
+    std::vector<TAC*> outsideJumps;
+    for (int predecessor : header.predecessors) {
+        if (loop.blocks.count(predecessor)) continue;
+        TAC* last = cfg.blocks[predecessor].instructions.back();
+        if ((last->getType() == TACType::JUMP && last->getOp1() == headerLabel->getOp1()) ||
+            ((last->getType() == TACType::IFZ || last->getType() == TACType::IFNZ) &&
+             last->getOp2() == headerLabel->getOp1())) {
+            outsideJumps.push_back(last);
+        }
+    }
+
+    if (!outsideJumps.empty()) {
+        Symbol* preheaderLabel = makeLabel();
+        tacInsertBefore(headerLabel, new TAC(TACType::LABEL, nullptr, preheaderLabel));
+        for (TAC* jump : outsideJumps) {
+            if (jump->getType() == TACType::JUMP) {
+                jump->setOp1(preheaderLabel);
+            } else {
+                jump->setOp2(preheaderLabel);
+            }
+        }
+    }
+
+    for (TAC* tac : instructions) {
+        tacInsertBefore(headerLabel, tac);
+    }
+}
+
+// Helper function to add an edge between two blocks, ignoring duplicates
+void addEdge(FunctionCFG& cfg, int from, int to) {
+    for (int successor : cfg.blocks[from].successors) {
+        if (successor == to) return;
+    }
+    cfg.blocks[from].successors.push_back(to);
+    cfg.blocks[to].predecessors.push_back(from);
+}
+
+// Helper function to split the body of one function into blocks and connect them
+void buildFunctionBlocks(FunctionCFG& cfg) {
+    // Partition: a label starts a new block, a jump/return ends the current one
+    int current = -1;
+    for (TAC* tac = cfg.begin->getNext(); tac && tac != cfg.end; tac = tac->getNext()) {
+        if (tac->getType() == TACType::LABEL && current >= 0 && !cfg.blocks[current].instructions.empty()) {
+            current = -1;
+        }
+        if (current < 0) {
+            BasicBlock block;
+            block.id = static_cast<int>(cfg.blocks.size());
+            cfg.blocks.push_back(block);
+            current = block.id;
+        }
+        if (tac->getType() == TACType::LABEL) {
+            cfg.labelBlocks[tac->getOp1()] = current;
+        }
+        cfg.blocks[current].instructions.push_back(tac);
+        if (isBlockTerminator(tac)) {
+            current = -1;
+        }
+    }
+
+    // Edges: explicit jump targets plus the fall-through to the next block
+    int blockCount = static_cast<int>(cfg.blocks.size());
+    for (int i = 0; i < blockCount; i++) {
+        TAC* last = cfg.blocks[i].instructions.back();
+        bool fallsThrough = true;
+
+        if (last->getType() == TACType::JUMP || last->getType() == TACType::IFZ || last->getType() == TACType::IFNZ) {
+            Symbol* target = last->getType() == TACType::JUMP ? last->getOp1() : last->getOp2();
+            auto it = cfg.labelBlocks.find(target);
+            if (it != cfg.labelBlocks.end()) {
+                addEdge(cfg, i, it->second);
+            }
+            fallsThrough = last->getType() != TACType::JUMP;
+        } else if (last->getType() == TACType::JUMPTABLE) {
+            for (Symbol* target : getJumpTableTargets(last)) {
+                auto it = cfg.labelBlocks.find(target);
+                if (it != cfg.labelBlocks.end()) {
+                    addEdge(cfg, i, it->second);
+                }
+            }
+            fallsThrough = false;
+        } else if (last->getType() == TACType::RET) {
+            fallsThrough = false;
+        }
+
+        if (fallsThrough && i + 1 < blockCount) {
+            addEdge(cfg, i, i + 1);
+        }
+    }
+}
+
+std::vector<FunctionCFG> buildCFG(TAC* tacHead) {
+    std::vector<FunctionCFG> functions;
+
+    // Global variables and vectors are the ones declared outside of any function
+    std::set<Symbol*> globals;
+    bool insideFunction = false;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() == TACType::BEGINFUN) insideFunction = true;
+        if (tac->getType() == TACType::ENDFUN) insideFunction = false;
+        if (insideFunction) continue;
+        if (tac->getType() == TACType::INIT) globals.insert(tac->getRes());
+        if (tac->getType() == TACType::BEGINVEC) globals.insert(tac->getOp1());
+    }
+
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() != TACType::BEGINFUN) continue;
+
+        FunctionCFG cfg;
+        cfg.function = tac->getOp1();
+        cfg.globals = globals;
+        cfg.begin = tac;
+        cfg.end = tac->getNext();
+        while (cfg.end && cfg.end->getType() != TACType::ENDFUN) {
+            cfg.end = cfg.end->getNext();
+        }
+
+        buildFunctionBlocks(cfg);
+        functions.push_back(cfg);
+
+        if (!cfg.end) break;
+        tac = cfg.end;
+    }
+
+    return functions;
+}
@@ -0,0 +1,58 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Control flow graph (CFG) header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef CFG_HPP
+#define CFG_HPP
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+class TAC;
+class Symbol;
+
+// Basic block - maximal straight-line sequence of TAC instructions
+struct BasicBlock {
+    int id;                             // Index of the block inside its function
+    std::vector<TAC*> instructions;     // Instructions of the block, in order
+    std::vector<int> successors;        // Blocks that may execute right after this one
+    std::vector<int> predecessors;      // Blocks that may execute right before this one
+};
+
+// Control flow graph of a single function (instructions between BEGINFUN and ENDFUN)
+struct FunctionCFG {
+    Symbol* function;                               // Function symbol
+    TAC* begin;                                     // BEGINFUN instruction
+    TAC* end;                                       // ENDFUN instruction
+    std::vector<BasicBlock> blocks;                 // Blocks in TAC order (blocks[0] is the entry)
+    std::unordered_map<Symbol*, int> labelBlocks;   // Label symbol to the block it starts
+    std::set<Symbol*> globals;                      // Global variables and vectors of the program
+};
+
+// Live variables at the boundaries of each block of a function
+struct Liveness {
+    std::vector<std::set<Symbol*>> liveIn;          // Variables live at the start of each block
+    std::vector<std::set<Symbol*>> liveOut;         // Variables live at the end of each block
+};
+
+// Natural loop: the header plus every block that reaches a back edge to it without passing the header
+struct NaturalLoop {
+    int header;                                     // Block every iteration starts at
+    std::set<int> blocks;                           // Blocks of the loop, header included
+};
+
+// Public interface functions
+std::vector<FunctionCFG> buildCFG(TAC* tacHead);    // Build one CFG per function of the TAC list
+bool isBlockTerminator(TAC* tac);                   // Checks if the instruction ends a basic block
+bool isVariableSymbol(Symbol* symbol);              // Checks if the symbol names storage (not a literal or label)
+std::vector<Symbol*> getUsedSymbols(TAC* tac);      // Variables read by the instruction
+Symbol* getDefinedSymbol(TAC* tac);                 // Variable completely overwritten by the instruction
+Liveness computeLiveness(const FunctionCFG& cfg);   // Backwards live variable analysis over the CFG
+void updateLiveness(TAC* tac, const FunctionCFG& cfg, std::set<Symbol*>& live); // Steps the live set backwards over tac
+std::vector<bool> findReachableBlocks(const FunctionCFG& cfg); // reachable[b] is true if b can run after the entry
+std::vector<std::vector<bool>> computeDominators(const FunctionCFG& cfg); // dominators[b][d] is true if d dominates b
+std::vector<NaturalLoop> findNaturalLoops(const FunctionCFG& cfg, const std::vector<std::vector<bool>>& dominators); // Innermost loops first
+TAC* findPreheaderPosition(const FunctionCFG& cfg, const NaturalLoop& loop); // Header label a preheader can go before, or nullptr
+void insertPreheader(const FunctionCFG& cfg, const NaturalLoop& loop, const std::vector<TAC*>& instructions); // Place unlinked instructions before the header
+
+#endif // CFG_HPP
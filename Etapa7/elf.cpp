@@ -0,0 +1,1358 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// ELF object writer source code made by Nathan Alonso Guimarães (00334437)
+
+#include "elf.hpp"
+#include <cctype>
+#include <fstream>
+#include <initializer_list>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+// Operand of an instruction, in AT&T syntax
+struct Operand {
+    enum class Kind { REGISTER, IMMEDIATE, MEMORY, SYMBOL } kind;
+    int reg;                            // Register number (0 to 15), base register of a memory operand
+    int size;                           // Register size in bits: 8, 32, 64, 128 (xmm) or 256 (ymm)
+    int index;                          // Index register of a memory operand, -1 when there is none
+    int scale;
+    bool rip;                           // "symbol(%rip)"
+    bool indirect;                      // "*%rax", target of an indirect jump or call
+    bool shortAddress;                  // Memory operand with 32-bit registers ("(%eax,%eax,2)"), prefix 67
+    int64_t value;                      // Immediate or displacement
+    std::string symbol;                 // Branch target or displacement symbol
+};
+
+// 32-bit field whose value depends on a label: symbol + addend (- base when there is one) - address of the field
+struct Fixup {
+    size_t position;
+    std::string symbol;
+    int64_t addend;
+    std::string base;                   // ".long target - base" entries of the jump tables
+    bool call;
+};
+
+// Piece of a section: encoded bytes, a branch whose size is chosen once the labels are placed, or an alignment
+struct Fragment {
+    enum class Kind { BYTES, BRANCH, ALIGN } kind;
+    std::vector<uint8_t> bytes;
+    std::vector<Fixup> fixups;          // Positions relative to the start of the fragment
+    int condition;                      // Condition code of a conditional branch, -1 for jmp
+    std::string target;
+    bool wide;                          // Branch with a 32-bit displacement
+    int alignment;                      // Power of two of an alignment
+};
+
+struct SectionState {
+    std::string name;
+    std::vector<Fragment> fragments;
+    std::vector<uint64_t> offsets;      // Start of each fragment, and the end of the section
+    uint64_t alignment;
+};
+
+struct LabelPosition {
+    int section;
+    size_t fragment;                    // Labels sit at the start of a fragment
+};
+
+// State of the assembly of one file
+static std::vector<SectionState> sections;
+static std::map<std::string, LabelPosition> labels;
+static std::set<std::string> globals;
+static int currentSection;
+
+// Condition codes of jcc, setcc and cmovcc
+static const std::unordered_map<std::string, int> conditionCodes = {
+    {"o", 0},   {"no", 1},  {"b", 2},   {"c", 2},   {"nae", 2}, {"ae", 3},  {"nb", 3},  {"nc", 3},
+    {"e", 4},   {"z", 4},   {"ne", 5},  {"nz", 5},  {"be", 6},  {"na", 6},  {"a", 7},   {"nbe", 7},
+    {"s", 8},   {"ns", 9},  {"p", 10},  {"pe", 10}, {"np", 11}, {"po", 11}, {"l", 12},  {"nge", 12},
+    {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14}, {"g", 15},  {"nle", 15}};
+
+// Operation number (ModRM reg field) of the arithmetic instructions, whose opcodes are number * 8 + 0 to 5
+static const std::unordered_map<std::string, int> arithmeticOperations = {
+    {"add", 0}, {"or", 1}, {"adc", 2}, {"sbb", 3}, {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7}};
+
+// Operation number of the shifts (opcodes C1, D1 and D3)
+static const std::unordered_map<std::string, int> shiftOperations = {
+    {"rol", 0}, {"ror", 1}, {"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7}};
+
+// Operation number of the one operand instructions of opcode F7
+static const std::unordered_map<std::string, int> unaryOperations = {
+    {"not", 2}, {"neg", 3}, {"mul", 4}, {"imul", 5}, {"div", 6}, {"idiv", 7}};
+
+// Packed integer instruction "op source, destination": 66 [0F 38] 0F opcode, and three operands with a VEX prefix
+struct PackedOperation {
+    int map;                            // 1 = 0F, 2 = 0F 38
+    int opcode;
+};
+
+static const std::unordered_map<std::string, PackedOperation> packedOperations = {
+    {"paddd", {1, 0xFE}},     {"paddq", {1, 0xD4}},     {"psubd", {1, 0xFA}},     {"psubq", {1, 0xFB}},
+    {"pand", {1, 0xDB}},      {"pandn", {1, 0xDF}},     {"por", {1, 0xEB}},       {"pxor", {1, 0xEF}},
+    {"pcmpgtd", {1, 0x66}},   {"pcmpeqd", {1, 0x76}},   {"pmuludq", {1, 0xF4}},   {"punpckldq", {1, 0x62}},
+    {"punpcklqdq", {1, 0x6C}}, {"pmulld", {2, 0x40}},   {"pmaxsd", {2, 0x3D}},    {"pminsd", {2, 0x39}}};
+
+// Packed shifts by an immediate "op $n, register": 66 0F opcode /operation ib
+struct PackedShift {
+    int opcode;
+    int operation;
+};
+
+static const std::unordered_map<std::string, PackedShift> packedShifts = {
+    {"psrld", {0x72, 2}}, {"psrad", {0x72, 4}}, {"pslld", {0x72, 6}},
+    {"psrlq", {0x73, 2}}, {"psllq", {0x73, 6}}, {"psrldq", {0x73, 3}}, {"pslldq", {0x73, 7}}};
+
+// Register name (without the %) to number and size, built once
+struct RegisterName {
+    int number;
+    int size;
+};
+
+static std::unordered_map<std::string, RegisterName> makeRegisterNames() {
+    static const char* quadRegisters[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
+    static const char* longRegisters[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+    static const char* byteRegisters[] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil"};
+    std::unordered_map<std::string, RegisterName> names;
+    for (int i = 0; i < 8; i++) {
+        names[quadRegisters[i]] = {i, 64};
+        names[longRegisters[i]] = {i, 32};
+        names[byteRegisters[i]] = {i, 8};
+    }
+    // %r8 to %r15 (with the d and b suffixes), %xmm0 to %xmm15 and %ymm0 to %ymm15
+    for (int i = 0; i < 16; i++) {
+        const std::string number = std::to_string(i);
+        if (i >= 8) {
+            names["r" + number] = {i, 64};
+            names["r" + number + "d"] = {i, 32};
+            names["r" + number + "b"] = {i, 8};
+        }
+        names["xmm" + number] = {i, 128};
+        names["ymm" + number] = {i, 256};
+    }
+    return names;
+}
+
+// Helper function to read the number and size of a register name without the %
+static bool parseRegister(const std::string& name, int& number, int& size) {
+    static const std::unordered_map<std::string, RegisterName> registerNames = makeRegisterNames();
+    auto it = registerNames.find(name);
+    if (it == registerNames.end()) return false;
+    number = it->second.number;
+    size = it->second.size;
+    return true;
+}
+
+// Helper function to read a number the way the GNU assembler does (0x hexadecimal, leading 0 octal)
+static bool parseNumber(const std::string& text, int64_t& value) {
+    size_t position = 0;
+    bool negative = false;
+    if (position < text.size() && (text[position] == '-' || text[position] == '+')) {
+        negative = text[position] == '-';
+        position++;
+    }
+    if (position >= text.size()) return false;
+
+    int base = 10;
+    if (text.compare(position, 2, "0x") == 0 || text.compare(position, 2, "0X") == 0) {
+        base = 16;
+        position += 2;
+    } else if (text[position] == '0' && position + 1 < text.size()) {
+        base = 8;
+        position++;
+    }
+    if (position >= text.size()) return false;
+
+    uint64_t magnitude = 0;
+    for (; position < text.size(); position++) {
+        int digit = std::isdigit(static_cast<unsigned char>(text[position])) ? text[position] - '0'
+                    : std::isxdigit(static_cast<unsigned char>(text[position]))
+                        ? std::tolower(static_cast<unsigned char>(text[position])) - 'a' + 10
+                        : 99;
+        if (digit >= base) return false;
+        magnitude = magnitude * static_cast<uint64_t>(base) + static_cast<uint64_t>(digit);
+    }
+    value = static_cast<int64_t>(negative ? 0 - magnitude : magnitude);
+    return true;
+}
+
+static bool isSymbolCharacter(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$' || c == '@';
+}
+
+// Helper function to read "symbol", "symbol+n", "symbol-n" or "n"
+static bool parseExpression(const std::string& text, std::string& symbol, int64_t& value) {
+    symbol.clear();
+    value = 0;
+    if (text.empty()) return true;
+    if (std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '-' || text[0] == '+') {
+        return parseNumber(text, value);
+    }
+
+    size_t end = 0;
+    while (end < text.size() && isSymbolCharacter(text[end])) end++;
+    symbol = text.substr(0, end);
+    return end == text.size() || ((text[end] == '+' || text[end] == '-') && parseNumber(text.substr(end), value));
+}
+
+// Helper function to read an operand: %register, $immediate, displacement(base, index, scale) or a branch target
+static bool parseOperand(const std::string& argument, Operand& operand) {
+    operand.kind = Operand::Kind::SYMBOL;
+    operand.reg = -1;
+    operand.size = 0;
+    operand.index = -1;
+    operand.scale = 1;
+    operand.rip = false;
+    operand.indirect = false;
+    operand.shortAddress = false;
+    operand.value = 0;
+    operand.symbol.clear();
+
+    operand.indirect = !argument.empty() && argument[0] == '*';
+    const std::string text = operand.indirect ? argument.substr(1) : argument;
+    if (text.empty()) return false;
+
+    if (text[0] == '%') {
+        operand.kind = Operand::Kind::REGISTER;
+        return parseRegister(text.substr(1), operand.reg, operand.size);
+    }
+    if (text[0] == '$') {
+        operand.kind = Operand::Kind::IMMEDIATE;
+        return parseNumber(text.substr(1), operand.value);
+    }
+
+    size_t open = text.find('(');
+    if (open == std::string::npos) {
+        // Branch targets are plain symbols
+        operand.symbol = text;
+        for (char c : text) {
+            if (!isSymbolCharacter(c)) return false;
+        }
+        return true;
+    }
+
+    operand.kind = Operand::Kind::MEMORY;
+    if (text.back() != ')' || !parseExpression(text.substr(0, open), operand.symbol, operand.value)) return false;
+
+    // Base, index and scale between the parentheses
+    std::vector<std::string> parts;
+    std::string part;
+    for (size_t i = open + 1; i + 1 < text.size(); i++) {
+        if (text[i] == ',') {
+            parts.push_back(part);
+            part.clear();
+        } else if (text[i] != ' ') {
+            part += text[i];
+        }
+    }
+    parts.push_back(part);
+    if (parts.size() > 3) return false;
+
+    int size = 0;
+    if (parts[0] == "%rip" && parts.size() == 1) {
+        operand.rip = true;
+    } else if (parts[0].size() < 2 || parts[0][0] != '%' || !parseRegister(parts[0].substr(1), operand.reg, size) ||
+               (size != 64 && size != 32)) {
+        return false;
+    }
+    operand.shortAddress = size == 32;
+    if (parts.size() > 1) {
+        if (parts[1].size() < 2 || parts[1][0] != '%' || !parseRegister(parts[1].substr(1), operand.index, size) ||
+            size != (operand.shortAddress ? 32 : 64) || operand.index == 4) {
+            return false;
+        }
+    }
+    if (parts.size() > 2) {
+        int64_t scale = 0;
+        if (!parseNumber(parts[2], scale) || (scale != 1 && scale != 2 && scale != 4 && scale != 8)) return false;
+        operand.scale = static_cast<int>(scale);
+    }
+
+    // Symbols are only reached through %rip: the code is position independent
+    return operand.rip || operand.symbol.empty();
+}
+
+static bool fitsInByte(int64_t value) {
+    return value >= -128 && value <= 127;
+}
+
+static bool fitsInLong(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static void emitByte(Fragment& fragment, int value) {
+    fragment.bytes.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+static void emitValue(std::vector<uint8_t>& bytes, int64_t value, int size) {
+    for (int i = 0; i < size; i++) {
+        bytes.push_back(static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+    }
+}
+
+// Helper function to tell whether a byte register needs a REX prefix to be reached (%spl, %bpl, %sil and %dil)
+static bool needsByteRex(const Operand& operand) {
+    return operand.kind == Operand::Kind::REGISTER && operand.size == 8 && operand.reg >= 4 && operand.reg <= 7;
+}
+
+// Helper function to get the REX.X and REX.B bits of the ModRM r/m operand
+static int extensionBits(const Operand& operand) {
+    if (operand.kind == Operand::Kind::REGISTER) return (operand.reg >> 3) & 1;
+    int bits = 0;
+    if (operand.reg >= 0) bits |= (operand.reg >> 3) & 1;
+    if (operand.index >= 0) bits |= ((operand.index >> 3) & 1) << 1;
+    return bits;
+}
+
+// Helper function to emit the ModRM byte, with the SIB byte and displacement of memory operands
+// immediateSize is the number of bytes after the displacement, which RIP-relative addresses count from
+static void emitModRM(Fragment& fragment, int reg, const Operand& operand, int immediateSize) {
+    if (operand.kind == Operand::Kind::REGISTER) {
+        emitByte(fragment, 0xC0 | ((reg & 7) << 3) | (operand.reg & 7));
+        return;
+    }
+
+    if (operand.rip) {
+        emitByte(fragment, ((reg & 7) << 3) | 5);
+        if (!operand.symbol.empty()) {
+            fragment.fixups.push_back({fragment.bytes.size(), operand.symbol, operand.value - 4 - immediateSize, "", false});
+            emitValue(fragment.bytes, 0, 4);
+        } else {
+            emitValue(fragment.bytes, operand.value, 4);
+        }
+        return;
+    }
+
+    // %rbp and %r13 as base always take a displacement, %rsp and %r12 always take a SIB byte
+    int mode = operand.value == 0 && (operand.reg & 7) != 5 ? 0 : fitsInByte(operand.value) ? 1 : 2;
+    if (operand.index >= 0 || (operand.reg & 7) == 4) {
+        int scaleBits = operand.scale == 8 ? 3 : operand.scale == 4 ? 2 : operand.scale == 2 ? 1 : 0;
+        int index = operand.index >= 0 ? operand.index & 7 : 4;
+        emitByte(fragment, (mode << 6) | ((reg & 7) << 3) | 4);
+        emitByte(fragment, (scaleBits << 6) | (index << 3) | (operand.reg & 7));
+    } else {
+        emitByte(fragment, (mode << 6) | ((reg & 7) << 3) | (operand.reg & 7));
+    }
+    if (mode == 1) emitValue(fragment.bytes, operand.value, 1);
+    if (mode == 2) emitValue(fragment.bytes, operand.value, 4);
+}
+
+// Helper function to emit [prefix] [REX] opcode ModRM [SIB] [displacement] [immediate]
+static void encodeInstruction(Fragment& fragment, int prefix, bool wide, std::initializer_list<int> opcode, int reg,
+                              const Operand& operand, int immediateSize = 0, int64_t immediate = 0,
+                              bool byteRex = false) {
+    if (operand.shortAddress) emitByte(fragment, 0x67);
+    if (prefix) emitByte(fragment, prefix);
+    int rex = 0x40 | (wide ? 8 : 0) | (((reg >> 3) & 1) << 2) | extensionBits(operand);
+    if (rex != 0x40 || byteRex || needsByteRex(operand)) emitByte(fragment, rex);
+    for (int byte : opcode) {
+        emitByte(fragment, byte);
+    }
+    emitModRM(fragment, reg, operand, immediateSize);
+    emitValue(fragment.bytes, immediate, immediateSize);
+}
+
+// Helper function to emit a VEX-prefixed instruction (AVX2): reg, second source vvvv and the r/m operand
+static void encodeVex(Fragment& fragment, int pp, int map, bool wide, bool wideVector, int opcode, int reg, int vvvv,
+                      const Operand& operand, int immediateSize = 0, int64_t immediate = 0) {
+    int r = ((reg >> 3) & 1) ^ 1;
+    int extension = extensionBits(operand);
+    int x = ((extension >> 1) & 1) ^ 1;
+    int b = (extension & 1) ^ 1;
+    int last = ((~vvvv & 15) << 3) | (wideVector ? 4 : 0) | pp;
+    if (operand.shortAddress) emitByte(fragment, 0x67);
+    if (x == 1 && b == 1 && !wide && map == 1) {
+        emitByte(fragment, 0xC5);
+        emitByte(fragment, (r << 7) | last);
+    } else {
+        emitByte(fragment, 0xC4);
+        emitByte(fragment, (r << 7) | (x << 6) | (b << 5) | map);
+        emitByte(fragment, (wide ? 0x80 : 0) | last);
+    }
+    emitByte(fragment, opcode);
+    emitModRM(fragment, reg, operand, immediateSize);
+    emitValue(fragment.bytes, immediate, immediateSize);
+}
+
+static bool isRegister(const Operand& operand, int size) {
+    return operand.kind == Operand::Kind::REGISTER && operand.size == size;
+}
+
+static bool isMemory(const Operand& operand) {
+    return operand.kind == Operand::Kind::MEMORY;
+}
+
+// Helper function to check a general purpose operand (register of the given size or memory)
+static bool isRegisterOrMemory(const Operand& operand, int size) {
+    return isRegister(operand, size) || isMemory(operand);
+}
+
+static bool isVector(const Operand& operand) {
+    return operand.kind == Operand::Kind::REGISTER && operand.size >= 128;
+}
+
+static bool isVectorOrMemory(const Operand& operand) {
+    return isVector(operand) || isMemory(operand);
+}
+
+// Helper function to read the condition code at the end of a mnemonic ("jge", "setl", "cmovne")
+static int getCondition(const std::string& mnemonic, size_t start) {
+    auto it = conditionCodes.find(mnemonic.substr(start));
+    return it != conditionCodes.end() ? it->second : -1;
+}
+
+// Helper function to encode the packed integer (SSE2 and AVX2) instructions
+static bool encodePacked(const std::string& mnemonic, const std::vector<Operand>& operands, Fragment& fragment) {
+    bool vex = mnemonic[0] == 'v';
+    std::string name = vex ? mnemonic.substr(1) : mnemonic;
+    size_t count = operands.size();
+
+    if (vex && name == "zeroupper" && count == 0) {
+        emitByte(fragment, 0xC5);
+        emitByte(fragment, 0xF8);
+        emitByte(fragment, 0x77);
+        return true;
+    }
+
+    // Loads and stores: movdqa/movdqu (66/F3 0F 6F and 7F)
+    if ((name == "movdqa" || name == "movdqu") && count == 2) {
+        int prefix = name == "movdqa" ? 0x66 : 0xF3;
+        bool store = !isVector(operands[1]);
+        const Operand& reg = store ? operands[0] : operands[1];
+        const Operand& other = store ? operands[1] : operands[0];
+        if (!isVector(reg) || !isVectorOrMemory(other)) return false;
+        if (vex) {
+            encodeVex(fragment, prefix == 0x66 ? 1 : 2, 1, false, reg.size == 256, store ? 0x7F : 0x6F, reg.reg, 0, other);
+        } else {
+            if (reg.size != 128 || (isVector(other) && other.size != 128)) return false;
+            encodeInstruction(fragment, prefix, false, {0x0F, store ? 0x7F : 0x6F}, reg.reg, other);
+        }
+        return true;
+    }
+
+    // movd between a general purpose register (or memory) and the low lane (66 0F 6E and 7E)
+    if (name == "movd" && count == 2) {
+        bool toVector = isVector(operands[1]);
+        const Operand& vector = toVector ? operands[1] : operands[0];
+        const Operand& other = toVector ? operands[0] : operands[1];
+        if (!isRegister(vector, 128) || !isRegisterOrMemory(other, 32)) return false;
+        if (vex) {
+            encodeVex(fragment, 1, 1, false, false, toVector ? 0x6E : 0x7E, vector.reg, 0, other);
+        } else {
+            encodeInstruction(fragment, 0x66, false, {0x0F, toVector ? 0x6E : 0x7E}, vector.reg, other);
+        }
+        return true;
+    }
+
+    // pshufd $order, source, destination (66 0F 70 /r ib)
+    if (name == "pshufd" && count == 3) {
+        if (operands[0].kind != Operand::Kind::IMMEDIATE || !isVector(operands[2]) || !isVectorOrMemory(operands[1])) {
+            return false;
+        }
+        if (vex) {
+            encodeVex(fragment, 1, 1, false, operands[2].size == 256, 0x70, operands[2].reg, 0, operands[1], 1,
+                      operands[0].value);
+        } else {
+            encodeInstruction(fragment, 0x66, false, {0x0F, 0x70}, operands[2].reg, operands[1], 1, operands[0].value);
+        }
+        return true;
+    }
+
+    // vpbroadcastd source, destination (VEX 66 0F 38 58) and vextracti128 $half, source, destination (VEX 66 0F 3A 39)
+    if (vex && name == "pbroadcastd" && count == 2 && isVector(operands[1]) &&
+        (isRegister(operands[0], 128) || isMemory(operands[0]))) {
+        encodeVex(fragment, 1, 2, false, operands[1].size == 256, 0x58, operands[1].reg, 0, operands[0]);
+        return true;
+    }
+    if (vex && name == "extracti128" && count == 3 && operands[0].kind == Operand::Kind::IMMEDIATE &&
+        isRegister(operands[1], 256) && (isRegister(operands[2], 128) || isMemory(operands[2]))) {
+        encodeVex(fragment, 1, 3, false, true, 0x39, operands[1].reg, 0, operands[2], 1, operands[0].value);
+        return true;
+    }
+
+    // Shifts by an immediate: the register is the r/m operand, vvvv holds the destination of the VEX form
+    auto shift = packedShifts.find(name);
+    if (shift != packedShifts.end() && operands.size() == (vex ? 3u : 2u) && operands[0].kind == Operand::Kind::IMMEDIATE) {
+        const Operand& source = operands[1];
+        const Operand& destination = operands.back();
+        if (!isVector(source) || !isVector(destination)) return false;
+        if (vex) {
+            encodeVex(fragment, 1, 1, false, destination.size == 256, shift->second.opcode, shift->second.operation,
+                      destination.reg, source, 1, operands[0].value);
+        } else {
+            if (source.reg != destination.reg) return false;
+            encodeInstruction(fragment, 0x66, false, {0x0F, shift->second.opcode}, shift->second.operation, destination, 1,
+                              operands[0].value);
+        }
+        return true;
+    }
+
+    // Two operand SSE form "op source, destination", three operand VEX form "op source2, source1, destination"
+    auto operation = packedOperations.find(name);
+    if (operation == packedOperations.end()) return false;
+    if (vex) {
+        if (count != 3 || !isVectorOrMemory(operands[0]) || !isVector(operands[1]) || !isVector(operands[2])) return false;
+        encodeVex(fragment, 1, operation->second.map, false, operands[2].size == 256, operation->second.opcode,
+                  operands[2].reg, operands[1].reg, operands[0]);
+        return true;
+    }
+    if (count != 2 || !isVectorOrMemory(operands[0]) || !isRegister(operands[1], 128)) return false;
+    if (operation->second.map == 2) {
+        encodeInstruction(fragment, 0x66, false, {0x0F, 0x38, operation->second.opcode}, operands[1].reg, operands[0]);
+    } else {
+        encodeInstruction(fragment, 0x66, false, {0x0F, operation->second.opcode}, operands[1].reg, operands[0]);
+    }
+    return true;
+}
+
+// Helper function to encode the general purpose instructions whose mnemonic ends with the operand size (l or q)
+static bool encodeSized(const std::string& stem, bool wide, const std::vector<Operand>& operands, Fragment& fragment) {
+    int size = wide ? 64 : 32;
+    size_t count = operands.size();
+    const Operand* source = count > 0 ? &operands[0] : nullptr;
+    const Operand* destination = count > 0 ? &operands[count - 1] : nullptr;
+    bool immediateSource = count == 2 && source->kind == Operand::Kind::IMMEDIATE;
+    int64_t immediate = immediateSource ? source->value : 0;
+
+    // Immediates of 32-bit instructions may be written unsigned ($0xFFFFFFF0), 64-bit ones are sign-extended
+    if (immediateSource) {
+        if (!wide && immediate >= 0 && immediate <= static_cast<int64_t>(UINT32_MAX)) {
+            immediate = static_cast<int32_t>(static_cast<uint32_t>(immediate));
+        }
+        if (!fitsInLong(immediate) && !(stem == "mov" && wide && isRegister(*destination, 64))) return false;
+    }
+
+    if (stem == "mov" && count == 2) {
+        if (immediateSource && isRegister(*destination, size)) {
+            if (wide && fitsInLong(immediate)) {
+                encodeInstruction(fragment, 0, true, {0xC7}, 0, *destination, 4, immediate);
+                return true;
+            }
+            if (destination->reg >= 8 || wide) emitByte(fragment, 0x40 | (wide ? 8 : 0) | (destination->reg >> 3));
+            emitByte(fragment, 0xB8 + (destination->reg & 7));
+            emitValue(fragment.bytes, immediate, wide ? 8 : 4);
+            return true;
+        }
+        if (immediateSource && isMemory(*destination)) {
+            encodeInstruction(fragment, 0, wide, {0xC7}, 0, *destination, 4, immediate);
+            return true;
+        }
+        if (isRegister(*source, size) && isRegisterOrMemory(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {0x89}, source->reg, *destination);
+            return true;
+        }
+        if (isMemory(*source) && isRegister(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {0x8B}, destination->reg, *source);
+            return true;
+        }
+        return false;
+    }
+
+    auto arithmetic = arithmeticOperations.find(stem);
+    if (arithmetic != arithmeticOperations.end() && count == 2) {
+        int operation = arithmetic->second;
+        if (immediateSource && isRegisterOrMemory(*destination, size)) {
+            if (fitsInByte(immediate)) {
+                encodeInstruction(fragment, 0, wide, {0x83}, operation, *destination, 1, immediate);
+            } else {
+                encodeInstruction(fragment, 0, wide, {0x81}, operation, *destination, 4, immediate);
+            }
+            return true;
+        }
+        if (isRegister(*source, size) && isRegisterOrMemory(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {operation * 8 + 1}, source->reg, *destination);
+            return true;
+        }
+        if (isMemory(*source) && isRegister(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {operation * 8 + 3}, destination->reg, *source);
+            return true;
+        }
+        return false;
+    }
+
+    if (stem == "test" && count == 2) {
+        if (immediateSource && isRegisterOrMemory(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {0xF7}, 0, *destination, 4, immediate);
+            return true;
+        }
+        if (isRegister(*source, size) && isRegisterOrMemory(*destination, size)) {
+            encodeInstruction(fragment, 0, wide, {0x85}, source->reg, *destination);
+            return true;
+        }
+        return false;
+    }
+
+    if (stem == "lea" && count == 2 && isMemory(*source) && isRegister(*destination, size)) {
+        encodeInstruction(fragment, 0, wide, {0x8D}, destination->reg, *source);
+        return true;
+    }
+
+    // imul has three forms: "imul x" (edx:eax = eax * x), "imul x, reg" and "imul $k, x, reg"
+    if (stem == "imul" && (count == 2 || count == 3) && isRegister(*destination, size)) {
+        const Operand& factor = count == 3 ? operands[1] : *destination;
+        if (source->kind == Operand::Kind::IMMEDIATE) {
+            int64_t value = source->value;
+            if (!wide && value >= 0 && value <= static_cast<int64_t>(UINT32_MAX)) {
+                value = static_cast<int32_t>(static_cast<uint32_t>(value));
+            }
+            if (!isRegisterOrMemory(factor, size) || !fitsInLong(value)) return false;
+            if (fitsInByte(value)) {
+                encodeInstruction(fragment, 0, wide, {0x6B}, destination->reg, factor, 1, value);
+            } else {
+                encodeInstruction(fragment, 0, wide, {0x69}, destination->reg, factor, 4, value);
+            }
+            return true;
+        }
+        if (count == 2 && isRegisterOrMemory(*source, size)) {
+            encodeInstruction(fragment, 0, wide, {0x0F, 0xAF}, destination->reg, *source);
+            return true;
+        }
+        return false;
+    }
+
+    auto unary = unaryOperations.find(stem);
+    if (unary != unaryOperations.end() && count == 1 && isRegisterOrMemory(*source, size)) {
+        encodeInstruction(fragment, 0, wide, {0xF7}, unary->second, *source);
+        return true;
+    }
+
+    if ((stem == "inc" || stem == "dec") && count == 1 && isRegisterOrMemory(*source, size)) {
+        encodeInstruction(fragment, 0, wide, {0xFF}, stem == "inc" ? 0 : 1, *source);
+        return true;
+    }
+
+    auto shift = shiftOperations.find(stem);
+    if (shift != shiftOperations.end() && (count == 1 || count == 2) && isRegisterOrMemory(*destination, size)) {
+        if (count == 1 || (immediateSource && immediate == 1)) {
+            encodeInstruction(fragment, 0, wide, {0xD1}, shift->second, *destination);
+        } else if (immediateSource) {
+            encodeInstruction(fragment, 0, wide, {0xC1}, shift->second, *destination, 1, immediate);
+        } else if (isRegister(*source, 8) && source->reg == 1) {
+            encodeInstruction(fragment, 0, wide, {0xD3}, shift->second, *destination);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // push and pop only exist with 64-bit operands
+    if ((stem == "push" || stem == "pop") && wide && count == 1) {
+        int base = stem == "push" ? 0x50 : 0x58;
+        if (isRegister(*source, 64)) {
+            if (source->reg >= 8) emitByte(fragment, 0x41);
+            emitByte(fragment, base + (source->reg & 7));
+            return true;
+        }
+        if (isMemory(*source)) {
+            encodeInstruction(fragment, 0, false, {stem == "push" ? 0xFF : 0x8F}, stem == "push" ? 6 : 0, *source);
+            return true;
+        }
+        if (stem == "push" && source->kind == Operand::Kind::IMMEDIATE && fitsInLong(source->value)) {
+            bool small = fitsInByte(source->value);
+            emitByte(fragment, small ? 0x6A : 0x68);
+            emitValue(fragment.bytes, source->value, small ? 1 : 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper function to start a fragment at the end of the current section
+static Fragment& newFragment(Fragment::Kind kind) {
+    Fragment fragment;
+    fragment.kind = kind;
+    fragment.condition = -1;
+    fragment.wide = false;
+    fragment.alignment = 0;
+    sections[static_cast<size_t>(currentSection)].fragments.push_back(fragment);
+    return sections[static_cast<size_t>(currentSection)].fragments.back();
+}
+
+// Helper function to get the fragment that the next bytes go to, the last one when it holds bytes
+static Fragment& currentBytes() {
+    std::vector<Fragment>& fragments = sections[static_cast<size_t>(currentSection)].fragments;
+    if (!fragments.empty() && fragments.back().kind == Fragment::Kind::BYTES) return fragments.back();
+    return newFragment(Fragment::Kind::BYTES);
+}
+
+// Helper function to encode one instruction at the end of fragment, branches become fragments of their own
+static bool encodeLine(const std::string& mnemonic, const std::vector<Operand>& operands, Fragment& fragment) {
+    size_t count = operands.size();
+
+    // Instructions without operands
+    static const std::unordered_map<std::string, std::vector<int>> fixedInstructions = {
+        {"ret", {0xC3}},        {"retq", {0xC3}},       {"leave", {0xC9}},      {"leaveq", {0xC9}},
+        {"nop", {0x90}},        {"cltq", {0x48, 0x98}}, {"cdqe", {0x48, 0x98}}, {"cltd", {0x99}},
+        {"cdq", {0x99}},        {"cqto", {0x48, 0x99}}, {"cqo", {0x48, 0x99}},  {"rep stosl", {0xF3, 0xAB}},
+        {"rep stosq", {0xF3, 0x48, 0xAB}},              {"rep movsl", {0xF3, 0xA5}},
+        {"rep movsq", {0xF3, 0x48, 0xA5}},              {"rep stosb", {0xF3, 0xAA}},
+        {"rep movsb", {0xF3, 0xA4}}};
+    auto fixed = fixedInstructions.find(mnemonic);
+    if (fixed != fixedInstructions.end()) {
+        if (count != 0) return false;
+        for (int byte : fixed->second) {
+            emitByte(fragment, byte);
+        }
+        return true;
+    }
+
+    // Branches to labels are sized later, indirect ones are "jmp *reg"
+    if (mnemonic == "jmp" || (mnemonic[0] == 'j' && getCondition(mnemonic, 1) >= 0)) {
+        if (count != 1) return false;
+        if (operands[0].indirect) {
+            if (mnemonic != "jmp" || !isRegister(operands[0], 64)) return false;
+            encodeInstruction(fragment, 0, false, {0xFF}, 4, operands[0]);
+            return true;
+        }
+        if (operands[0].kind != Operand::Kind::SYMBOL) return false;
+        Fragment& branch = newFragment(Fragment::Kind::BRANCH);
+        branch.condition = mnemonic == "jmp" ? -1 : getCondition(mnemonic, 1);
+        branch.target = operands[0].symbol;
+        return true;
+    }
+
+    if (mnemonic == "call" || mnemonic == "callq") {
+        if (count != 1) return false;
+        if (operands[0].indirect) {
+            if (!isRegister(operands[0], 64)) return false;
+            encodeInstruction(fragment, 0, false, {0xFF}, 2, operands[0]);
+            return true;
+        }
+        if (operands[0].kind != Operand::Kind::SYMBOL) return false;
+
+        // "call printf@PLT" names the same function
+        std::string target = operands[0].symbol;
+        if (target.size() > 4 && target.compare(target.size() - 4, 4, "@PLT") == 0) target.erase(target.size() - 4);
+        emitByte(fragment, 0xE8);
+        fragment.fixups.push_back({fragment.bytes.size(), target, -4, "", true});
+        emitValue(fragment.bytes, 0, 4);
+        return true;
+    }
+
+    // setcc writes a byte register, cmovcc takes the size of its registers
+    if (mnemonic.compare(0, 3, "set") == 0 && getCondition(mnemonic, 3) >= 0) {
+        if (count != 1 || !isRegisterOrMemory(operands[0], 8)) return false;
+        encodeInstruction(fragment, 0, false, {0x0F, 0x90 + getCondition(mnemonic, 3)}, 0, operands[0]);
+        return true;
+    }
+    if (mnemonic.compare(0, 4, "cmov") == 0) {
+        std::string condition = mnemonic.substr(4);
+        int code = getCondition(condition, 0);
+        if (code < 0 && condition.size() > 1 && (condition.back() == 'l' || condition.back() == 'q')) {
+            code = getCondition(condition.substr(0, condition.size() - 1), 0);
+        }
+        if (code < 0 || count != 2 || operands[1].kind != Operand::Kind::REGISTER) return false;
+        int size = operands[1].size;
+        if ((size != 32 && size != 64) || !isRegisterOrMemory(operands[0], size)) return false;
+        encodeInstruction(fragment, 0, size == 64, {0x0F, 0x40 + code}, operands[1].reg, operands[0]);
+        return true;
+    }
+
+    // Sign and zero extensions name both sizes
+    if (mnemonic == "movslq" && count == 2 && isRegisterOrMemory(operands[0], 32) && isRegister(operands[1], 64)) {
+        encodeInstruction(fragment, 0, true, {0x63}, operands[1].reg, operands[0]);
+        return true;
+    }
+    if ((mnemonic == "movzbl" || mnemonic == "movsbl") && count == 2 && isRegisterOrMemory(operands[0], 8) &&
+        isRegister(operands[1], 32)) {
+        encodeInstruction(fragment, 0, false, {0x0F, mnemonic == "movzbl" ? 0xB6 : 0xBE}, operands[1].reg, operands[0], 0,
+                          0, needsByteRex(operands[0]));
+        return true;
+    }
+
+    // movq between a vector register and a general purpose register (66 REX.W 0F 6E and 7E)
+    if (mnemonic == "movq" && count == 2 && (isVector(operands[0]) || isVector(operands[1]))) {
+        bool toVector = isVector(operands[1]);
+        const Operand& vector = toVector ? operands[1] : operands[0];
+        const Operand& other = toVector ? operands[0] : operands[1];
+        if (!isRegister(vector, 128) || !isRegisterOrMemory(other, 64)) return false;
+        encodeInstruction(fragment, 0x66, true, {0x0F, toVector ? 0x6E : 0x7E}, vector.reg, other);
+        return true;
+    }
+
+    bool stack = mnemonic.compare(0, 4, "push") == 0 || mnemonic.compare(0, 3, "pop") == 0;
+    if ((mnemonic[0] == 'p' && !stack) || mnemonic[0] == 'v' || mnemonic.compare(0, 4, "movd") == 0) {
+        return encodePacked(mnemonic, operands, fragment);
+    }
+
+    char suffix = mnemonic.back();
+    if (mnemonic.size() > 1 && (suffix == 'l' || suffix == 'q')) {
+        return encodeSized(mnemonic.substr(0, mnemonic.size() - 1), suffix == 'q', operands, fragment);
+    }
+    return false;
+}
+
+// Helper function to remove a comment, keeping the # inside strings
+static std::string stripComment(const std::string& line) {
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '\\' && quoted) {
+            i++;
+        } else if (line[i] == '"') {
+            quoted = !quoted;
+        } else if (line[i] == '#' && !quoted) {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+static std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+// Helper function to split operands at the commas outside of parentheses
+static std::vector<std::string> splitOperands(const std::string& text) {
+    std::vector<std::string> parts;
+    std::string part;
+    int depth = 0;
+    for (char c : text) {
+        if (c == '(') depth++;
+        if (c == ')') depth--;
+        if (c == ',' && depth == 0) {
+            parts.push_back(trim(part));
+            part.clear();
+        } else {
+            part += c;
+        }
+    }
+    if (!trim(part).empty() || !parts.empty()) parts.push_back(trim(part));
+    return parts;
+}
+
+// Helper function to decode the escapes of a .string or .ascii argument
+static bool parseString(const std::string& text, std::vector<uint8_t>& bytes) {
+    if (text.size() < 2 || text.front() != '"' || text.back() != '"') return false;
+    for (size_t i = 1; i + 1 < text.size(); i++) {
+        char c = text[i];
+        if (c != '\\') {
+            bytes.push_back(static_cast<uint8_t>(c));
+            continue;
+        }
+        if (++i + 1 > text.size() - 1) return false;
+        char escape = text[i];
+        switch (escape) {
+            case 'n': bytes.push_back('\n'); break;
+            case 't': bytes.push_back('\t'); break;
+            case 'r': bytes.push_back('\r'); break;
+            case 'b': bytes.push_back('\b'); break;
+            case 'f': bytes.push_back('\f'); break;
+            case 'x': {
+                int value = 0;
+                while (i + 1 < text.size() - 1 && std::isxdigit(static_cast<unsigned char>(text[i + 1]))) {
+                    char digit = static_cast<char>(std::tolower(static_cast<unsigned char>(text[++i])));
+                    value = value * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : digit - 'a' + 10);
+                }
+                bytes.push_back(static_cast<uint8_t>(value & 0xFF));
+                break;
+            }
+            default:
+                if (escape >= '0' && escape <= '7') {
+                    int value = escape - '0';
+                    for (int digits = 1; digits < 3 && i + 1 < text.size() - 1 && text[i + 1] >= '0' && text[i + 1] <= '7';
+                         digits++) {
+                        value = value * 8 + (text[++i] - '0');
+                    }
+                    bytes.push_back(static_cast<uint8_t>(value & 0xFF));
+                } else {
+                    bytes.push_back(static_cast<uint8_t>(escape));
+                }
+        }
+    }
+    return true;
+}
+
+static void selectSection(const std::string& name) {
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (sections[i].name == name) {
+            currentSection = static_cast<int>(i);
+            return;
+        }
+    }
+    SectionState section;
+    section.name = name;
+    section.alignment = name == ".text" ? 16 : 1;
+    sections.push_back(section);
+    currentSection = static_cast<int>(sections.size() - 1);
+}
+
+// Helper function to handle a directive (.section, .globl, .long, .string, ...)
+static bool assembleDirective(const std::string& directive, const std::string& arguments, std::string& error) {
+    if (directive == ".text" || directive == ".data" || directive == ".bss") {
+        selectSection(directive);
+        return true;
+    }
+    if (directive == ".section") {
+        std::string name = trim(arguments.substr(0, arguments.find(',')));
+        if (name != ".text" && name != ".data" && name != ".bss" && name != ".rodata" && name != ".note.GNU-stack") {
+            error = "unknown section " + name;
+            return false;
+        }
+        selectSection(name);
+        return true;
+    }
+    if (directive == ".globl" || directive == ".global") {
+        globals.insert(trim(arguments));
+        return true;
+    }
+    if (directive == ".extern" || directive == ".type" || directive == ".size" || directive == ".file") {
+        return true;
+    }
+
+    if (currentSection < 0) {
+        error = "data outside of a section";
+        return false;
+    }
+    SectionState& section = sections[static_cast<size_t>(currentSection)];
+
+    if (directive == ".p2align" || directive == ".align") {
+        int64_t value = 0;
+        if (!parseNumber(trim(arguments.substr(0, arguments.find(','))), value) || value < 0 || value > 12) return false;
+        // .align takes the number of bytes on x86
+        int power = static_cast<int>(value);
+        if (directive == ".align") {
+            power = 0;
+            while ((1LL << power) < value) power++;
+        }
+        newFragment(Fragment::Kind::ALIGN).alignment = power;
+        if ((1ULL << power) > section.alignment) section.alignment = 1ULL << power;
+        return true;
+    }
+
+    Fragment& fragment = currentBytes();
+    if (directive == ".string" || directive == ".asciz" || directive == ".ascii") {
+        if (!parseString(trim(arguments), fragment.bytes)) return false;
+        if (directive != ".ascii") fragment.bytes.push_back(0);
+        return true;
+    }
+    if (directive == ".zero" || directive == ".skip") {
+        int64_t size = 0;
+        if (!parseNumber(trim(arguments), size) || size < 0) return false;
+        fragment.bytes.insert(fragment.bytes.end(), static_cast<size_t>(size), 0);
+        return true;
+    }
+
+    int size = directive == ".byte" ? 1 : directive == ".long" || directive == ".int" ? 4 : directive == ".quad" ? 8 : 0;
+    if (size == 0) {
+        error = "unknown directive " + directive;
+        return false;
+    }
+    for (const std::string& argument : splitOperands(arguments)) {
+        std::string expression;
+        for (char c : argument) {
+            if (c != ' ') expression += c;
+        }
+
+        // "target - base" is the distance between two labels (jump table entries)
+        size_t minus = expression.find('-', 1);
+        if (size == 4 && minus != std::string::npos && !std::isdigit(static_cast<unsigned char>(expression[0]))) {
+            fragment.fixups.push_back({fragment.bytes.size(), expression.substr(0, minus), 0, expression.substr(minus + 1), false});
+            emitValue(fragment.bytes, 0, 4);
+            continue;
+        }
+        int64_t value = 0;
+        if (!parseNumber(expression, value)) {
+            error = "unsupported data value " + argument;
+            return false;
+        }
+        emitValue(fragment.bytes, value, size);
+    }
+    return true;
+}
+
+// Helper function to compute the offsets of the fragments of a section with the current branch sizes
+static void placeFragments(SectionState& section) {
+    section.offsets.assign(section.fragments.size() + 1, 0);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < section.fragments.size(); i++) {
+        const Fragment& fragment = section.fragments[i];
+        section.offsets[i] = offset;
+        if (fragment.kind == Fragment::Kind::BYTES) {
+            offset += fragment.bytes.size();
+        } else if (fragment.kind == Fragment::Kind::BRANCH) {
+            offset += fragment.wide ? (fragment.condition < 0 ? 5 : 6) : 2;
+        } else {
+            uint64_t mask = (1ULL << fragment.alignment) - 1;
+            offset = (offset + mask) & ~mask;
+        }
+    }
+    section.offsets[section.fragments.size()] = offset;
+}
+
+static uint64_t labelOffset(const LabelPosition& position) {
+    return sections[static_cast<size_t>(position.section)].offsets[position.fragment];
+}
+
+// Helper function to choose the branch sizes: every branch starts short (2 bytes) and gets a 32-bit displacement
+// when its target is too far, until nothing changes (branches only grow, so this ends)
+static void relaxBranches(int sectionIndex) {
+    SectionState& section = sections[static_cast<size_t>(sectionIndex)];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        placeFragments(section);
+        for (size_t i = 0; i < section.fragments.size(); i++) {
+            Fragment& fragment = section.fragments[i];
+            if (fragment.kind != Fragment::Kind::BRANCH || fragment.wide) continue;
+            auto label = labels.find(fragment.target);
+            if (label == labels.end() || label->second.section != sectionIndex) {
+                fragment.wide = true;
+                changed = true;
+                continue;
+            }
+            int64_t distance = static_cast<int64_t>(labelOffset(label->second)) - static_cast<int64_t>(section.offsets[i] + 2);
+            if (!fitsInByte(distance)) {
+                fragment.wide = true;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Helper function to write a 32-bit value inside already emitted bytes
+static void patchValue(std::vector<uint8_t>& bytes, size_t position, int64_t value) {
+    for (int i = 0; i < 4; i++) {
+        bytes[position + static_cast<size_t>(i)] = static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+}
+
+// Helper function to find (or add, as an undefined function) the symbol of a label
+static int getSymbol(ObjectCode& code, std::map<std::string, int>& symbolIndexes, const std::string& name) {
+    auto it = symbolIndexes.find(name);
+    if (it != symbolIndexes.end()) return it->second;
+    code.symbols.push_back({name, -1, 0, true});
+    symbolIndexes[name] = static_cast<int>(code.symbols.size() - 1);
+    return symbolIndexes[name];
+}
+
+// Helper function to lay out the sections, solve the labels of each section and keep the other references as relocations
+static bool finishObject(ObjectCode& code, std::string& error) {
+    for (size_t i = 0; i < sections.size(); i++) {
+        relaxBranches(static_cast<int>(i));
+    }
+
+    std::map<std::string, int> symbolIndexes;
+    for (const auto& label : labels) {
+        code.symbols.push_back({label.first, label.second.section, labelOffset(label.second), globals.count(label.first) > 0});
+        symbolIndexes[label.first] = static_cast<int>(code.symbols.size() - 1);
+    }
+
+    for (size_t s = 0; s < sections.size(); s++) {
+        SectionState& state = sections[s];
+        ObjectSection section;
+        section.name = state.name;
+        section.alignment = state.alignment;
+        int sectionIndex = static_cast<int>(s);
+
+        for (size_t i = 0; i < state.fragments.size(); i++) {
+            Fragment& fragment = state.fragments[i];
+            uint64_t start = state.offsets[i];
+            if (fragment.kind == Fragment::Kind::ALIGN) {
+                // Code is padded with the long NOPs recommended by the manuals, data with zeros
+                static const std::vector<std::vector<int>> nops = {
+                    {0x90}, {0x66, 0x90}, {0x0F, 0x1F, 0x00}, {0x0F, 0x1F, 0x40, 0x00}, {0x0F, 0x1F, 0x44, 0x00, 0x00},
+                    {0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00}, {0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+                    {0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}};
+                size_t padding = static_cast<size_t>(state.offsets[i + 1] - start);
+                while (padding > 0) {
+                    size_t size = padding < nops.size() ? padding : nops.size();
+                    for (int byte : nops[size - 1]) {
+                        section.bytes.push_back(static_cast<uint8_t>(state.name == ".text" ? byte : 0));
+                    }
+                    padding -= size;
+                }
+                continue;
+            }
+
+            if (fragment.kind == Fragment::Kind::BRANCH) {
+                fragment.bytes.clear();
+                fragment.fixups.clear();
+                if (!fragment.wide) {
+                    fragment.bytes.push_back(static_cast<uint8_t>(fragment.condition < 0 ? 0xEB : 0x70 + fragment.condition));
+                    int64_t distance = static_cast<int64_t>(labelOffset(labels[fragment.target])) - static_cast<int64_t>(start + 2);
+                    fragment.bytes.push_back(static_cast<uint8_t>(distance & 0xFF));
+                } else {
+                    if (fragment.condition >= 0) fragment.bytes.push_back(0x0F);
+                    fragment.bytes.push_back(static_cast<uint8_t>(fragment.condition < 0 ? 0xE9 : 0x80 + fragment.condition));
+                    fragment.fixups.push_back({fragment.bytes.size(), fragment.target, -4, "", false});
+                    emitValue(fragment.bytes, 0, 4);
+                }
+            }
+
+            for (const Fixup& fixup : fragment.fixups) {
+                uint64_t position = start + fixup.position;
+                int64_t addend = fixup.addend;
+                if (!fixup.base.empty()) {
+                    auto base = labels.find(fixup.base);
+                    if (base == labels.end() || base->second.section != sectionIndex) {
+                        error = "label " + fixup.base + " must be defined in the same section as its use";
+                        return false;
+                    }
+                    addend += static_cast<int64_t>(position) - static_cast<int64_t>(labelOffset(base->second));
+                }
+
+                auto label = labels.find(fixup.symbol);
+                if (label != labels.end() && label->second.section == sectionIndex) {
+                    int64_t value = static_cast<int64_t>(labelOffset(label->second)) + addend - static_cast<int64_t>(position);
+                    if (!fitsInLong(value)) {
+                        error = "reference to " + fixup.symbol + " out of range";
+                        return false;
+                    }
+                    patchValue(fragment.bytes, fixup.position, value);
+                    continue;
+                }
+                int symbol = getSymbol(code, symbolIndexes, fixup.symbol);
+                uint32_t type = fixup.call && code.symbols[static_cast<size_t>(symbol)].section < 0 ? RELOCATION_PLT32
+                                                                                                    : RELOCATION_PC32;
+                code.relocations.push_back({sectionIndex, position, symbol, type, addend});
+            }
+            section.bytes.insert(section.bytes.end(), fragment.bytes.begin(), fragment.bytes.end());
+        }
+        code.sections.push_back(section);
+    }
+    return true;
+}
+
+// Public interface function
+// Assembles the instructions and directives that generateASM emits: general purpose instructions, SSE2 and AVX2
+// packed integer instructions, and the .long/.string/.p2align data of the .data, .rodata and .text sections
+bool assembleObject(const std::vector<std::string>& lines, ObjectCode& code, std::string& error) {
+    sections.clear();
+    labels.clear();
+    globals.clear();
+    currentSection = -1;
+    code = ObjectCode();
+
+    std::vector<Operand> operands;
+    for (size_t number = 0; number < lines.size(); number++) {
+        // Comments and blank lines are most of the listing
+        const std::string& text = lines[number];
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos || text[first] == '#') continue;
+        std::string line = text.find('#') == std::string::npos ? trim(text) : trim(stripComment(text));
+        auto where = [number]() { return "line " + std::to_string(number + 1) + ": "; };
+
+        // Labels, possibly followed by a statement ("str_0: .string ...")
+        size_t end = 0;
+        while (end < line.size() && isSymbolCharacter(line[end])) end++;
+        if (end > 0 && end < line.size() && line[end] == ':') {
+            std::string name = line.substr(0, end);
+            if (currentSection < 0 || labels.count(name)) {
+                error = where() + "label " + name + (currentSection < 0 ? " outside of a section" : " defined twice");
+                return false;
+            }
+            // A label starts a new fragment, where the bytes after it go
+            labels[name] = {currentSection, sections[static_cast<size_t>(currentSection)].fragments.size()};
+            newFragment(Fragment::Kind::BYTES);
+            line = trim(line.substr(end + 1));
+        }
+        if (line.empty()) continue;
+
+        size_t space = line.find_first_of(" \t");
+        std::string mnemonic = line.substr(0, space);
+        std::string arguments = space == std::string::npos ? "" : trim(line.substr(space));
+
+        if (mnemonic[0] == '.') {
+            if (!assembleDirective(mnemonic, arguments, error)) {
+                error = where() + (error.empty() ? "invalid directive \"" + line + "\"" : error);
+                return false;
+            }
+            continue;
+        }
+
+        // "rep stosl" is a single instruction
+        if (mnemonic == "rep") {
+            mnemonic += " " + arguments;
+            arguments.clear();
+        }
+
+        operands.clear();
+        for (const std::string& argument : splitOperands(arguments)) {
+            Operand operand;
+            if (!parseOperand(argument, operand)) {
+                error = where() + "invalid operand \"" + argument + "\"";
+                return false;
+            }
+            operands.push_back(operand);
+        }
+        if (currentSection < 0) {
+            error = where() + "instruction outside of a section";
+            return false;
+        }
+        if (!encodeLine(mnemonic, operands, currentBytes())) {
+            error = where() + "unsupported instruction \"" + line + "\"";
+            return false;
+        }
+    }
+    return finishObject(code, error);
+}
+
+// ELF64 constants used by the writer
+static const uint32_t SECTION_PROGBITS = 1;
+static const uint32_t SECTION_SYMTAB = 2;
+static const uint32_t SECTION_STRTAB = 3;
+static const uint32_t SECTION_RELA = 4;
+static const uint32_t SECTION_NOBITS = 8;
+static const uint64_t FLAG_WRITE = 1;
+static const uint64_t FLAG_ALLOC = 2;
+static const uint64_t FLAG_EXECUTE = 4;
+static const uint64_t FLAG_INFO_LINK = 0x40;
+
+// Section header, written field by field in little endian
+struct SectionHeader {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t alignment;
+    uint64_t entrySize;
+};
+
+static void appendValue(std::vector<uint8_t>& image, uint64_t value, int size) {
+    emitValue(image, static_cast<int64_t>(value), size);
+}
+
+// Helper function to add a name to a string table, returning its offset
+static uint32_t addString(std::vector<uint8_t>& table, const std::string& text) {
+    uint32_t offset = static_cast<uint32_t>(table.size());
+    table.insert(table.end(), text.begin(), text.end());
+    table.push_back(0);
+    return offset;
+}
+
+// Helper function to append a block of the file at the given alignment, returning its offset
+static uint64_t appendBlock(std::vector<uint8_t>& image, const std::vector<uint8_t>& block, uint64_t alignment) {
+    while (alignment > 1 && image.size() % alignment != 0) image.push_back(0);
+    uint64_t offset = image.size();
+    image.insert(image.end(), block.begin(), block.end());
+    return offset;
+}
+
+// Public interface function
+// Layout: ELF header, section contents, symbol and string tables, relocations, section names and the section headers
+bool writeObjectFile(const ObjectCode& code, const std::string& outputFileName) {
+    std::vector<uint8_t> image(64, 0);
+    std::vector<SectionHeader> headers(1, SectionHeader{0, 0, 0, 0, 0, 0, 0, 0, 0});
+    std::vector<uint8_t> sectionNames(1, 0);
+
+    // Content sections keep their order, the first one is header 1
+    for (const ObjectSection& section : code.sections) {
+        SectionHeader header{addString(sectionNames, section.name), SECTION_PROGBITS, 0, 0, section.bytes.size(), 0, 0,
+                             section.alignment, 0};
+        if (section.name == ".text") header.flags = FLAG_ALLOC | FLAG_EXECUTE;
+        if (section.name == ".data") header.flags = FLAG_ALLOC | FLAG_WRITE;
+        if (section.name == ".rodata") header.flags = FLAG_ALLOC;
+        if (section.name == ".bss") {
+            header.type = SECTION_NOBITS;
+            header.flags = FLAG_ALLOC | FLAG_WRITE;
+            header.offset = image.size();
+        } else {
+            header.offset = appendBlock(image, section.bytes, section.alignment);
+        }
+        headers.push_back(header);
+    }
+
+    // Symbol table: the null symbol, one symbol per section, the local labels and then the global ones
+    // Relocations against labels of this object use the symbol of their section, as the GNU assembler does
+    std::vector<uint8_t> symbols;
+    std::vector<uint8_t> names(1, 0);
+    std::vector<uint32_t> symbolIndexes(code.symbols.size(), 0);
+    uint32_t count = 0;
+    auto addSymbol = [&](uint32_t name, int binding, int type, uint16_t section, uint64_t value) {
+        appendValue(symbols, name, 4);
+        appendValue(symbols, static_cast<uint64_t>((binding << 4) | type), 1);
+        appendValue(symbols, 0, 1);
+        appendValue(symbols, section, 2);
+        appendValue(symbols, value, 8);
+        appendValue(symbols, 0, 8);
+        return count++;
+    };
+    addSymbol(0, 0, 0, 0, 0);
+    for (size_t i = 0; i < code.sections.size(); i++) {
+        addSymbol(0, 0, 3, static_cast<uint16_t>(i + 1), 0);
+    }
+    uint32_t firstGlobal = 0;
+    for (int global = 0; global < 2; global++) {
+        if (global == 1) firstGlobal = count;
+        for (size_t i = 0; i < code.symbols.size(); i++) {
+            const ObjectSymbol& symbol = code.symbols[i];
+            if (symbol.global != (global == 1)) continue;
+            // .L labels are local to the assembly and stay out of the table
+            if (!symbol.global && symbol.name.compare(0, 2, ".L") == 0) continue;
+            uint16_t section = static_cast<uint16_t>(symbol.section < 0 ? 0 : symbol.section + 1);
+            symbolIndexes[i] = addSymbol(addString(names, symbol.name), global, 0, section, symbol.offset);
+        }
+    }
+
+    uint32_t symbolTableIndex = static_cast<uint32_t>(headers.size());
+    headers.push_back({addString(sectionNames, ".symtab"), SECTION_SYMTAB, 0, appendBlock(image, symbols, 8), symbols.size(),
+                       symbolTableIndex + 1, firstGlobal, 8, 24});
+    headers.push_back({addString(sectionNames, ".strtab"), SECTION_STRTAB, 0, appendBlock(image, names, 1), names.size(), 0,
+                       0, 1, 0});
+
+    for (size_t s = 0; s < code.sections.size(); s++) {
+        std::vector<uint8_t> entries;
+        for (const ObjectRelocation& relocation : code.relocations) {
+            if (relocation.section != static_cast<int>(s)) continue;
+            const ObjectSymbol& symbol = code.symbols[static_cast<size_t>(relocation.symbol)];
+            uint64_t index = symbolIndexes[static_cast<size_t>(relocation.symbol)];
+            int64_t addend = relocation.addend;
+            if (!symbol.global) {
+                index = static_cast<uint64_t>(symbol.section) + 1;
+                addend += static_cast<int64_t>(symbol.offset);
+            }
+            appendValue(entries, relocation.offset, 8);
+            appendValue(entries, (index << 32) | relocation.type, 8);
+            appendValue(entries, static_cast<uint64_t>(addend), 8);
+        }
+        if (entries.empty()) continue;
+        headers.push_back({addString(sectionNames, ".rela" + code.sections[s].name), SECTION_RELA, FLAG_INFO_LINK,
+                           appendBlock(image, entries, 8), entries.size(), symbolTableIndex, static_cast<uint32_t>(s + 1),
+                           8, 24});
+    }
+
+    uint32_t namesName = addString(sectionNames, ".shstrtab");
+    headers.push_back({namesName, SECTION_STRTAB, 0, appendBlock(image, sectionNames, 1), sectionNames.size(), 0, 0, 1, 0});
+
+    while (image.size() % 8 != 0) image.push_back(0);
+    uint64_t headersOffset = image.size();
+    for (const SectionHeader& header : headers) {
+        appendValue(image, header.name, 4);
+        appendValue(image, header.type, 4);
+        appendValue(image, header.flags, 8);
+        appendValue(image, 0, 8);
+        appendValue(image, header.offset, 8);
+        appendValue(image, header.size, 8);
+        appendValue(image, header.link, 4);
+        appendValue(image, header.info, 4);
+        appendValue(image, header.alignment, 8);
+        appendValue(image, header.entrySize, 8);
+    }
+
+    // ELF header: 64-bit, little endian, relocatable object for x86-64
+    std::vector<uint8_t> header = {0x7F, 'E', 'L', 'F', 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    appendValue(header, 1, 2);
+    appendValue(header, 62, 2);
+    appendValue(header, 1, 4);
+    appendValue(header, 0, 8);
+    appendValue(header, 0, 8);
+    appendValue(header, headersOffset, 8);
+    appendValue(header, 0, 4);
+    appendValue(header, 64, 2);
+    appendValue(header, 0, 2);
+    appendValue(header, 0, 2);
+    appendValue(header, 64, 2);
+    appendValue(header, headers.size(), 2);
+    appendValue(header, headers.size() - 1, 2);
+    std::copy(header.begin(), header.end(), image.begin());
+
+    std::ofstream file(outputFileName, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,52 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// ELF object writer header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef ELF_HPP
+#define ELF_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Relocation types of the x86-64 ELF ABI produced by the encoder
+const uint32_t RELOCATION_PC32 = 2;     // S + A - P in 32 bits: RIP-relative data and jump table entries
+const uint32_t RELOCATION_PLT32 = 4;    // Same value, for calls to functions defined by another object (the runtime)
+
+// Contents of one section (.text, .data, .bss, .rodata or .note.GNU-stack)
+struct ObjectSection {
+    std::string name;
+    std::vector<uint8_t> bytes;         // Zeros for .bss, which takes no room in the file
+    uint64_t alignment;
+};
+
+// Label of the assembly, or a function of another object when section is -1
+struct ObjectSymbol {
+    std::string name;
+    int section;                        // Index in ObjectCode::sections
+    uint64_t offset;
+    bool global;                        // Declared with .globl, or undefined
+};
+
+// 32-bit field at sections[section].bytes[offset] to fill with symbol + addend - address of the field
+// References inside one section are solved by the encoder, only the ones between sections remain
+struct ObjectRelocation {
+    int section;
+    uint64_t offset;
+    int symbol;                         // Index in ObjectCode::symbols
+    uint32_t type;
+    int64_t addend;
+};
+
+struct ObjectCode {
+    std::vector<ObjectSection> sections;
+    std::vector<ObjectSymbol> symbols;
+    std::vector<ObjectRelocation> relocations;
+};
+
+// Public interface functions
+// Encodes the lines of an assembly file made by generateASM into machine code, false (and the reason) for lines it does not know
+bool assembleObject(const std::vector<std::string>& lines, ObjectCode& code, std::string& error);
+// Writes the code as an ELF64 relocatable object, ready to be linked with the runtime
+bool writeObjectFile(const ObjectCode& code, const std::string& outputFileName);
+
+#endif // ELF_HPP
@@ -0,0 +1,161 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// In-memory execution (JIT) source code made by Nathan Alonso Guimarães (00334437)
+
+#include "jit.hpp"
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Functions of runtime.c, linked into the compiler itself for --run
+extern "C" {
+void runtimePrintInt(int value);
+void runtimePrintString(const char* text);
+int runtimeReadInt(void);
+void runtimeFlush(void);
+}
+
+// Size of the indirect jump that reaches a runtime function from anywhere: jmp *0(%rip) followed by the address
+static const size_t STUB_SIZE = 16;
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+// Helper function to find the address of a function of the runtime called by the generated code
+static bool findRuntimeFunction(const std::string& name, uint64_t& address) {
+    static const std::map<std::string, uint64_t> functions = {
+        {"runtimePrintInt", reinterpret_cast<uintptr_t>(&runtimePrintInt)},
+        {"runtimePrintString", reinterpret_cast<uintptr_t>(&runtimePrintString)},
+        {"runtimeReadInt", reinterpret_cast<uintptr_t>(&runtimeReadInt)},
+        {"runtimeFlush", reinterpret_cast<uintptr_t>(&runtimeFlush)}};
+    auto it = functions.find(name);
+    if (it == functions.end()) return false;
+    address = it->second;
+    return true;
+}
+
+// Public interface function
+// Layout of the mapping: .text, one stub per runtime function, then (from the next page on) the data sections.
+// The mapping may be far from the compiler, so calls reach the runtime through the stubs instead of a rel32
+bool loadProgram(const ObjectCode& code, LoadedProgram& program, std::string& error) {
+    program.memory = nullptr;
+    program.size = 0;
+    program.entry = nullptr;
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    std::vector<size_t> sectionStarts(code.sections.size(), 0);
+    size_t size = 0;
+    for (size_t i = 0; i < code.sections.size(); i++) {
+        if (code.sections[i].name != ".text") continue;
+        size = alignUp(size, static_cast<size_t>(code.sections[i].alignment));
+        sectionStarts[i] = size;
+        size += code.sections[i].bytes.size();
+    }
+
+    // Undefined symbols are the runtime functions called by the code
+    std::map<int, size_t> stubStarts;
+    size = alignUp(size, STUB_SIZE);
+    for (size_t i = 0; i < code.symbols.size(); i++) {
+        if (code.symbols[i].section >= 0) continue;
+        stubStarts[static_cast<int>(i)] = size;
+        size += STUB_SIZE;
+    }
+    const size_t codeSize = alignUp(size, pageSize);
+
+    size = codeSize;
+    for (size_t i = 0; i < code.sections.size(); i++) {
+        if (code.sections[i].name == ".text" || code.sections[i].bytes.empty()) continue;
+        size = alignUp(size, static_cast<size_t>(code.sections[i].alignment));
+        sectionStarts[i] = size;
+        size += code.sections[i].bytes.size();
+    }
+    size = alignUp(size, pageSize);
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        error = "could not map " + std::to_string(size) + " bytes";
+        return false;
+    }
+    uint8_t* base = static_cast<uint8_t*>(memory);
+    const uint64_t baseAddress = reinterpret_cast<uintptr_t>(memory);
+    program.memory = memory;
+    program.size = size;
+
+    for (size_t i = 0; i < code.sections.size(); i++) {
+        if (!code.sections[i].bytes.empty()) {
+            std::memcpy(base + sectionStarts[i], code.sections[i].bytes.data(), code.sections[i].bytes.size());
+        }
+    }
+    for (const auto& stub : stubStarts) {
+        const std::string& name = code.symbols[static_cast<size_t>(stub.first)].name;
+        uint64_t address = 0;
+        if (!findRuntimeFunction(name, address)) {
+            error = "undefined function " + name;
+            unloadProgram(program);
+            return false;
+        }
+        static const uint8_t jump[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+        std::memcpy(base + stub.second, jump, sizeof(jump));
+        std::memcpy(base + stub.second + sizeof(jump), &address, sizeof(address));
+        std::memset(base + stub.second + sizeof(jump) + sizeof(address), 0xCC, STUB_SIZE - sizeof(jump) - sizeof(address));
+    }
+
+    // Both relocation types are S + A - P in 32 bits, the runtime functions being replaced by their stubs
+    for (const ObjectRelocation& relocation : code.relocations) {
+        const ObjectSymbol& symbol = code.symbols[static_cast<size_t>(relocation.symbol)];
+        if (symbol.section < 0 && relocation.type != RELOCATION_PLT32) {
+            error = "data reference to the undefined symbol " + symbol.name;
+            unloadProgram(program);
+            return false;
+        }
+        uint64_t target = symbol.section >= 0
+                              ? baseAddress + sectionStarts[static_cast<size_t>(symbol.section)] + symbol.offset
+                              : baseAddress + stubStarts[relocation.symbol];
+        size_t position = sectionStarts[static_cast<size_t>(relocation.section)] + relocation.offset;
+        int64_t value = static_cast<int64_t>(target - (baseAddress + position)) + relocation.addend;
+        if (value < INT32_MIN || value > INT32_MAX) {
+            error = "reference to " + symbol.name + " out of range";
+            unloadProgram(program);
+            return false;
+        }
+        int32_t field = static_cast<int32_t>(value);
+        std::memcpy(base + position, &field, sizeof(field));
+    }
+
+    for (const ObjectSymbol& symbol : code.symbols) {
+        if (symbol.name == "main" && symbol.section >= 0) {
+            uint64_t address = baseAddress + sectionStarts[static_cast<size_t>(symbol.section)] + symbol.offset;
+            program.entry = reinterpret_cast<int (*)()>(static_cast<uintptr_t>(address));
+        }
+    }
+    if (!program.entry) {
+        error = "the program has no main";
+        unloadProgram(program);
+        return false;
+    }
+
+    // The code is never writable and executable at the same time
+    if (mprotect(memory, codeSize, PROT_READ | PROT_EXEC) != 0) {
+        error = "could not make the code executable";
+        unloadProgram(program);
+        return false;
+    }
+    return true;
+}
+
+// Public interface function
+int runProgram(const LoadedProgram& program) {
+    int status = program.entry();
+    runtimeFlush();
+    return status;
+}
+
+// Public interface function
+void unloadProgram(LoadedProgram& program) {
+    if (program.memory) munmap(program.memory, program.size);
+    program.memory = nullptr;
+    program.size = 0;
+    program.entry = nullptr;
+}
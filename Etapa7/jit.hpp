@@ -0,0 +1,25 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// In-memory execution (JIT) header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "elf.hpp"
+#include <string>
+
+// Machine code of a program loaded into executable memory, ready to be called
+struct LoadedProgram {
+    void* memory;                       // Start of the mapping, nullptr when nothing is loaded
+    size_t size;
+    int (*entry)();                     // main of the program
+};
+
+// Public interface functions
+// Places the sections of the code in one mapping, links the calls to the runtime of this process and protects the
+// code as executable, false (and the reason) for code that can not be loaded
+bool loadProgram(const ObjectCode& code, LoadedProgram& program, std::string& error);
+// Calls main and flushes the output it left in the runtime buffer, returning the value of main
+int runProgram(const LoadedProgram& program);
+void unloadProgram(LoadedProgram& program);
+
+#endif // JIT_HPP
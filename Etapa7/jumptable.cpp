@@ -0,0 +1,242 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Equality chain lowering implementation file made by Nathan Alonso Guimarães (00334437)
+
+#include "jumptable.hpp"
+#include "tac.hpp"
+#include "cfg.hpp"
+#include "symbol.hpp"
+#include "parser.tab.hpp"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+// Tables of the JUMPTABLE instructions created by the lowering
+static std::map<TAC*, JumpTable> tables;
+
+// Limits of the lowering: shortest chain worth rewriting, and table entries allowed per case (a table at least one third full)
+static const size_t MIN_CHAIN_CASES = 4;
+static const long long MAX_ENTRIES_PER_CASE = 3;
+
+// Binary search ranges with this many cases or fewer are tested one by one
+static const size_t MAX_LINEAR_CASES = 3;
+
+const JumpTable* getJumpTable(TAC* tac) {
+    auto it = tables.find(tac);
+    return it != tables.end() ? &it->second : nullptr;
+}
+
+std::vector<Symbol*> getJumpTableTargets(TAC* tac) {
+    std::vector<Symbol*> targets;
+    const JumpTable* table = getJumpTable(tac);
+    if (!table) return targets;
+
+    targets.push_back(tac->getOp2());
+    for (Symbol* target : table->targets) {
+        if (std::find(targets.begin(), targets.end(), target) == targets.end()) targets.push_back(target);
+    }
+    return targets;
+}
+
+// One "t = x == k; IFZ t, next" test of a chain
+struct ChainCase {
+    int key;                // Value of the constant k
+    Symbol* constant;       // Literal k
+    TAC* compare;
+    TAC* branch;
+    Symbol* label;          // Start of the code run when x == k (nullptr when an earlier test has the same k)
+};
+
+// Helper function to read the value of an integer or character literal
+static bool getCaseKey(Symbol* symbol, int& key) {
+    if (!symbol || isVariableSymbol(symbol)) return false;
+
+    const std::string& text = symbol->getLexeme();
+    if (symbol->getType() == LIT_CHAR && text.length() == 3 && text[0] == '\'') {
+        key = static_cast<int>(text[1]);
+        return true;
+    }
+    if (symbol->getType() != LIT_INT || text.empty() || text.length() > 9) return false;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+    }
+    key = std::stoi(text);
+    return true;
+}
+
+// Helper function to match "t = x == k; IFZ t, next" where t is a temporary read only by the branch
+static bool matchCase(TAC* compare, const std::unordered_map<Symbol*, int>& uses, ChainCase& chainCase, Symbol*& value) {
+    if (!compare || compare->getType() != TACType::EQ) return false;
+    TAC* branch = compare->getNext();
+    Symbol* result = compare->getRes();
+    if (!branch || branch->getType() != TACType::IFZ || branch->getOp1() != result ||
+        result->getIdentifierType() != identifierType::TEMP) {
+        return false;
+    }
+    auto use = uses.find(result);
+    if (use == uses.end() || use->second != 1) return false;
+
+    // The constant may be on either side of the comparison
+    Symbol* tested = compare->getOp1();
+    Symbol* constant = compare->getOp2();
+    int key = 0;
+    if (!getCaseKey(constant, key)) {
+        std::swap(tested, constant);
+        if (!getCaseKey(constant, key)) return false;
+    }
+    if (!isVariableSymbol(tested) || tested->getDataType() == dataType::REAL) return false;
+
+    chainCase.key = key;
+    chainCase.constant = constant;
+    chainCase.compare = compare;
+    chainCase.branch = branch;
+    chainCase.label = nullptr;
+    value = tested;
+    return true;
+}
+
+// Helper function to follow an if-else chain on one value, starting at its first test
+// Each test must be reached only from the false side of the previous one, whose code ends with a JUMP or RET
+static std::vector<ChainCase> collectChain(TAC* compare, const std::unordered_map<Symbol*, int>& uses,
+                                           const std::unordered_map<Symbol*, TAC*>& labels,
+                                           const std::unordered_map<Symbol*, int>& labelUses, Symbol*& value) {
+    std::vector<ChainCase> chain;
+    ChainCase chainCase;
+    if (!matchCase(compare, uses, chainCase, value)) return chain;
+
+    while (true) {
+        chain.push_back(chainCase);
+        Symbol* next = chainCase.branch->getOp2();
+        auto label = labels.find(next);
+        auto labelUse = labelUses.find(next);
+        if (label == labels.end() || labelUse == labelUses.end() || labelUse->second != 1) break;
+
+        TAC* before = label->second->getPrev();
+        if (!before || (before->getType() != TACType::JUMP && before->getType() != TACType::RET)) break;
+
+        Symbol* tested = nullptr;
+        ChainCase following;
+        if (!matchCase(label->second->getNext(), uses, following, tested) || tested != value) break;
+
+        // The false target of a generated if is always further down, so the chain can not loop
+        bool forward = false;
+        for (TAC* tac = chainCase.branch->getNext(); tac && tac->getType() != TACType::ENDFUN; tac = tac->getNext()) {
+            if (tac == label->second) {
+                forward = true;
+                break;
+            }
+        }
+        if (!forward) break;
+        chainCase = following;
+    }
+    return chain;
+}
+
+// Helper function to emit, before position, a balanced binary search over cases[first, last) sorted by key
+static void emitBinarySearch(TAC* position, Symbol* value, const std::vector<ChainCase>& cases, size_t first, size_t last,
+                             Symbol* defaultLabel) {
+    if (last - first <= MAX_LINEAR_CASES) {
+        for (size_t i = first; i < last; i++) {
+            Symbol* equal = makeTemp();
+            tacInsertBefore(position, new TAC(TACType::EQ, equal, value, cases[i].constant));
+            tacInsertBefore(position, new TAC(TACType::IFNZ, nullptr, equal, cases[i].label));
+        }
+        tacInsertBefore(position, new TAC(TACType::JUMP, nullptr, defaultLabel));
+        return;
+    }
+
+    // Keys below the middle one go to the lower half, the others stay here
+    size_t middle = first + (last - first) / 2;
+    Symbol* lower = makeLabel();
+    Symbol* less = makeTemp();
+    tacInsertBefore(position, new TAC(TACType::LT, less, value, cases[middle].constant));
+    tacInsertBefore(position, new TAC(TACType::IFNZ, nullptr, less, lower));
+    emitBinarySearch(position, value, cases, middle, last, defaultLabel);
+    tacInsertBefore(position, new TAC(TACType::LABEL, nullptr, lower));
+    emitBinarySearch(position, value, cases, first, middle, defaultLabel);
+}
+
+// Equality chain lowering: "if (x == k1) ... else if (x == k2) ... else ..." tests x once through a jump table
+// when the constants are dense, or with a balanced binary search when they are sparse
+TAC* optimizeEqualityChains(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    std::unordered_map<Symbol*, int> uses;
+    std::unordered_map<Symbol*, TAC*> labels;
+    std::unordered_map<Symbol*, int> labelUses;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        for (Symbol* used : getUsedSymbols(tac)) {
+            uses[used]++;
+        }
+        if (tac->getType() == TACType::LABEL) labels[tac->getOp1()] = tac;
+        if (tac->getType() == TACType::JUMP) labelUses[tac->getOp1()]++;
+        if (tac->getType() == TACType::IFZ || tac->getType() == TACType::IFNZ) labelUses[tac->getOp2()]++;
+    }
+
+    int jumpTables = 0;
+    int binarySearches = 0;
+    int testsReplaced = 0;
+    TAC* current = tacHead;
+    while (current) {
+        Symbol* value = nullptr;
+        std::vector<ChainCase> chain = collectChain(current, uses, labels, labelUses, value);
+        if (chain.size() < MIN_CHAIN_CASES) {
+            current = current->getNext();
+            continue;
+        }
+
+        // Only the first test of a constant can be taken, the code of the others is never reached
+        std::vector<ChainCase> cases;
+        for (ChainCase& chainCase : chain) {
+            bool repeated = false;
+            for (const ChainCase& other : cases) {
+                if (other.key == chainCase.key) repeated = true;
+            }
+            if (repeated) continue;
+            chainCase.label = makeLabel();
+            tacInsertAfter(chainCase.branch, new TAC(TACType::LABEL, nullptr, chainCase.label));
+            cases.push_back(chainCase);
+        }
+        std::sort(cases.begin(), cases.end(), [](const ChainCase& a, const ChainCase& b) { return a.key < b.key; });
+
+        Symbol* defaultLabel = chain.back().branch->getOp2();
+        TAC* position = chain.front().compare;
+        long long entries = static_cast<long long>(cases.back().key) - cases.front().key + 1;
+        if (entries <= MAX_ENTRIES_PER_CASE * static_cast<long long>(cases.size())) {
+            JumpTable table;
+            table.low = cases.front().key;
+            table.targets.assign(static_cast<size_t>(entries), defaultLabel);
+            for (const ChainCase& chainCase : cases) {
+                table.targets[static_cast<size_t>(chainCase.key - table.low)] = chainCase.label;
+            }
+            TAC* jump = new TAC(TACType::JUMPTABLE, nullptr, value, defaultLabel);
+            tables[jump] = table;
+            tacInsertBefore(position, jump);
+            jumpTables++;
+        } else {
+            emitBinarySearch(position, value, cases, 0, cases.size(), defaultLabel);
+            binarySearches++;
+        }
+
+        // The tests go away, with the labels that only the previous test jumped to
+        current = chain.back().branch->getNext();
+        for (size_t i = 0; i < chain.size(); i++) {
+            if (i > 0) {
+                TAC* label = chain[i].compare->getPrev();
+                labels.erase(label->getOp1());
+                tacUnlink(label);
+                delete label;
+            }
+            tacUnlink(chain[i].compare);
+            tacUnlink(chain[i].branch);
+            delete chain[i].compare;
+            delete chain[i].branch;
+            testsReplaced++;
+        }
+    }
+
+    std::cout << "Equality chain lowering completed: " << jumpTables << " jump tables and " << binarySearches
+              << " binary searches replaced " << testsReplaced << " equality tests." << std::endl;
+
+    return tacHead;
+}
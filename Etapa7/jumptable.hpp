@@ -0,0 +1,23 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Equality chain lowering header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef JUMPTABLE_HPP
+#define JUMPTABLE_HPP
+
+#include <vector>
+
+class TAC;
+class Symbol;
+
+// Targets of a JUMPTABLE instruction "goto targets[value - low]", taken when low <= value < low + targets.size()
+struct JumpTable {
+    int low;                            // Smallest case constant
+    std::vector<Symbol*> targets;       // Case labels, the default label fills the holes between cases
+};
+
+// Public interface functions
+TAC* optimizeEqualityChains(TAC* tacHead);                  // Turns chains of "if (x == k)" into a JUMPTABLE or a binary search
+const JumpTable* getJumpTable(TAC* tac);                    // Table of a JUMPTABLE instruction
+std::vector<Symbol*> getJumpTableTargets(TAC* tac);         // Every label a JUMPTABLE may go to, default included
+
+#endif // JUMPTABLE_HPP
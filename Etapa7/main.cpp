@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <string>
 #include <fstream>
+#include <chrono>
+#include <iostream>
 #include "parser.tab.hpp"
 #include "symbol.hpp"
 #include "ast.hpp"
@@ -12,6 +14,8 @@
 #include "tac.hpp"
 #include "asm.hpp"
 #include "optimizer.hpp"
+#include "elf.hpp"
+#include "jit.hpp"
 
 int yyparse();
 extern char *yytext;
@@ -23,12 +27,61 @@ extern ASTNode* root;
 extern int getSyntaxErrors();
 string tokenName(int token);
 
+// Helper function to run the optimized code in this process (--run), returning the value of its main
+static int runOptimizedCode(TAC* optimizedTac, bool avx2, std::chrono::steady_clock::time_point compileStart) {
+    ObjectCode code;
+    LoadedProgram program;
+    std::string error;
+    std::vector<std::string> lines = generateASMLines(optimizedTac, true, avx2, false);
+    if (!assembleObject(lines, code, error) || !loadProgram(code, program, error)) {
+        fprintf(stderr, "- Error: The optimized code could not be run (%s).\n", error.c_str());
+        exit(5); // Exit code 5 for code that can not be run
+    }
+    fprintf(stderr, "- Optimized code loaded in memory (%zu bytes mapped).\n\n", program.size);
+
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+    int status = runProgram(program);
+    std::chrono::steady_clock::time_point runEnd = std::chrono::steady_clock::now();
+    unloadProgram(program);
+
+    fprintf(stderr, "\nCompile time: %.3f ms, run time: %.3f ms.\n",
+            std::chrono::duration<double, std::milli>(runStart - compileStart).count(),
+            std::chrono::duration<double, std::milli>(runEnd - runStart).count());
+    return status;
+}
+
 int main(int argc, char **argv){
+    std::chrono::steady_clock::time_point compileStart = std::chrono::steady_clock::now();
     if (argc < 7){
         fprintf(stderr, "Arguments missing.\n");
-        fprintf(stderr, "Call: ./etapa6 <input_file> <symbol_table_output> <ast_output> <decompiled_output> <tac_output> <assembly_output>\n");
+        fprintf(stderr, "Call: ./etapa6 <input_file> <symbol_table_output> <ast_output> <decompiled_output> <tac_output> <assembly_output> [--avx2] [--freestanding] [--object] [--run]\n");
         exit(1); // Exit code 1 for missing arguments
     }
+
+    // Optional flags after the output files
+    bool avx2 = false;
+    bool freestanding = false;
+    bool object = false;
+    bool run = false;
+    for (int i = 7; i < argc; i++) {
+        if (std::string(argv[i]) == "--avx2") {
+            avx2 = true;
+        }
+        if (std::string(argv[i]) == "--freestanding") {
+            freestanding = true;
+        }
+        if (std::string(argv[i]) == "--object") {
+            object = true;
+        }
+        if (std::string(argv[i]) == "--run") {
+            run = true;
+        }
+    }
+
+    // With --run the standard output belongs to the program: the reports of the optimizations go to stderr
+    if (run) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
     
     if (0 == (yyin = fopen(argv[1], "r"))){
         fprintf(stderr, "Input file %s not found.\n", argv[1]);
@@ -116,15 +169,17 @@ int main(int argc, char **argv){
             printSymbolTableToFile(argv[2]);
             fprintf(stderr, "- Symbol table saved to file \"%s\".\n", argv[2]);
 
-            // Generate assembly code using original TAC
-            std::ofstream asmFile(argv[6]);
-            if (!asmFile.is_open()) {
-                fprintf(stderr, "File %s could not be opened for writing.\n", argv[6]);
-                exit(2); // Exit code 2 for file not found
+            // Generate assembly code using original TAC (--run only needs the optimized code)
+            if (!run) {
+                std::ofstream asmFile(argv[6]);
+                if (!asmFile.is_open()) {
+                    fprintf(stderr, "File %s could not be opened for writing.\n", argv[6]);
+                    exit(2); // Exit code 2 for file not found
+                }
+                asmFile.close();
+                generateASM(originalTAC, argv[6], false, false, freestanding, object);
+                fprintf(stderr, "- Original assembly code saved to file \"%s\".\n", argv[6]);
             }
-            asmFile.close();
-            generateASM(originalTAC, argv[6]);
-            fprintf(stderr, "- Original assembly code saved to file \"%s\".\n", argv[6]);
 
 
 
@@ -159,6 +214,11 @@ int main(int argc, char **argv){
             printSymbolTableToFile(optimizedSymbolTableFilename);
             fprintf(stderr, "- Optimized symbol table saved to file \"%s\".\n", optimizedSymbolTableFilename.c_str());
 
+            // With --run the optimized code is encoded in memory and called instead of being written
+            if (run) {
+                return runOptimizedCode(optimizedTac, avx2, compileStart);
+            }
+
             // Generate assembly code using optimized TAC
             baseFilename = std::string(argv[6]);
             if (baseFilename.size() >= 1 && baseFilename.substr(baseFilename.size() - 2) == ".s") {
@@ -171,7 +231,7 @@ int main(int argc, char **argv){
                 exit(2); // Exit code 2 for file not found
             }
             optimizedAsmFile.close();
-            generateASM(optimizedTac, optimizedAsmFilename);
+            generateASM(optimizedTac, optimizedAsmFilename, true, avx2, freestanding, object);
             fprintf(stderr, "- Optimized assembly code saved to file \"%s\".\n", optimizedAsmFilename.c_str());
         } else {
             fprintf(stderr, "TAC generation failed.\n");
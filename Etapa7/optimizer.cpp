@@ -3,12 +3,22 @@
 
 #include "optimizer.hpp"
 #include "tac.hpp"
+#include "cfg.hpp"
+#include "vectorizer.hpp"
+#include "jumptable.hpp"
 #include "symbol.hpp"
 #include "parser.tab.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 
 // Helper function to check if a symbol represents a numeric literal
 bool isNumericLiteral(Symbol* symbol) {
@@ -132,64 +142,59 @@ double computeConstantExpression(double val1, double val2, TACType opType) {
     }
 }
 
-// Helper function to perform unary constant folding
-double computeUnaryConstantExpression(double val, TACType opType) {
+// Helper function to keep the low 32 bits of a value as a two's complement int, like the registers of the generated code
+int wrapInteger(int64_t value) {
+    uint32_t low = static_cast<uint32_t>(static_cast<uint64_t>(value) & 0xFFFFFFFFu);
+    return low <= static_cast<uint32_t>(INT32_MAX) ? static_cast<int>(low) : static_cast<int>(static_cast<int64_t>(low) - 0x100000000LL);
+}
+
+// Helper function to fold an integer operation the way the generated code computes it: addl, subl and imull wrap
+// around in 32 bits, and idivl truncates toward zero (divisions that trap are never folded, see isTrappingDivision)
+int computeIntegerExpression(int64_t val1, int64_t val2, TACType opType) {
+    int64_t result = 0;
     switch (opType) {
-        case TACType::NOT:
-            return (val == 0.0) ? 1.0 : 0.0;
+        case TACType::ADD:
+            result = val1 + val2;
+            break;
+        case TACType::SUB:
+            result = val1 - val2;
+            break;
+        case TACType::MUL:
+            result = val1 * val2;
+            break;
+        case TACType::DIV:
+            if (val2 != 0) result = val1 / val2;
+            break;
+        case TACType::MOD:
+            if (val2 != 0) result = val1 % val2;
+            break;
         default:
-            return val;
+            return static_cast<int>(computeConstantExpression(static_cast<double>(val1), static_cast<double>(val2), opType));
     }
+    return wrapInteger(result);
 }
 
-// Helper function to find the constant value assigned to a temporary variable
-Symbol* findConstantValue(TAC* tacHead, Symbol* tempVar) {
-    if (!tempVar || !tacHead) return nullptr;
-    
-    // Look for a MOVE instruction that assigns a constant to this temporary
-    TAC* current = tacHead;
-    while (current) {
-        if (current->getType() == TACType::MOVE && 
-            current->getRes() == tempVar && 
-            isNumericLiteral(current->getOp1())) {
-            return current->getOp1();
-        }
-        current = current->getNext();
-    }
-    
-    return nullptr;
+// Helper function to read an integer literal as the 32-bit value the generated code uses
+int64_t getIntegerValue(Symbol* symbol) {
+    return wrapInteger(std::strtoll(symbol->getLexeme().c_str(), nullptr, 10));
 }
 
-// Helper function to check if a symbol is used anywhere in the TAC after a given point
-bool isSymbolUsed(TAC* startPoint, Symbol* symbol) {
-    if (!startPoint || !symbol) return false;
-    
-    TAC* current = startPoint;
-    while (current) {
-        // Check if symbol is used as operand in any instruction
-        if (current->getOp1() == symbol || current->getOp2() == symbol) {
-            return true;
-        }
-        current = current->getNext();
-    }
-    
-    return false;
+// Helper function to check whether a division or modulo of two literals traps in idivl (a zero divisor, or
+// INT32_MIN by -1). It is left unfolded, so the optimized program stops with SIGFPE like the unoptimized one
+bool isTrappingDivision(Symbol* op1, Symbol* op2, TACType opType) {
+    if (opType != TACType::DIV && opType != TACType::MOD) return false;
+    if (getNumericValue(op2) == 0.0) return true;
+    return op1->getType() == LIT_INT && op2->getType() == LIT_INT && getIntegerValue(op1) == INT32_MIN &&
+           getIntegerValue(op2) == -1;
 }
 
-// Helper function to substitute all uses of a symbol with another symbol from a given point
-void substituteSymbolUses(TAC* startPoint, Symbol* oldSymbol, Symbol* newSymbol) {
-    if (!startPoint || !oldSymbol || !newSymbol) return;
-    
-    TAC* current = startPoint;
-    while (current) {
-        // Replace operand uses
-        if (current->getOp1() == oldSymbol) {
-            current->setOp1(newSymbol);
-        }
-        if (current->getOp2() == oldSymbol) {
-            current->setOp2(newSymbol);
-        }
-        current = current->getNext();
+// Helper function to perform unary constant folding
+double computeUnaryConstantExpression(double val, TACType opType) {
+    switch (opType) {
+        case TACType::NOT:
+            return (val == 0.0) ? 1.0 : 0.0;
+        default:
+            return val;
     }
 }
 
@@ -210,70 +215,7 @@ TAC* optimizeConstantFolding(TAC* tacHead) {
         while (current) {
             bool optimized = false;
             
-            // First, check for dead code elimination: MOVE instructions to unused temporaries
-            if (current->getType() == TACType::MOVE && 
-                current->getRes() && 
-                isNumericLiteral(current->getOp1())) {
-                
-                // Check if this temporary is used
-                
-                // Check if this temporary is used anywhere after this point
-                if (!isSymbolUsed(current->getNext(), current->getRes())) {
-                    // This is dead code - remove it
-                    if (current->getPrev()) {
-                        current->getPrev()->setNext(current->getNext());
-                    } else {
-                        tacHead = current->getNext(); // Update head if this was the first instruction
-                    }
-                    
-                    if (current->getNext()) {
-                        current->getNext()->setPrev(current->getPrev());
-                    }
-                    
-                    TAC* toDelete = current;
-                    current = current->getNext();
-                    delete toDelete;
-                    
-                    optimized = true;
-                    passOptimizations++;
-                    hasOptimizations = true;
-                    continue; // Skip the rest of the loop since we moved to next instruction
-                }
-            }
-            
-            // Second, check for constant propagation: replace uses of temporaries defined by MOVE with constants
-            if (current->getType() == TACType::MOVE && 
-                current->getRes() && 
-                isNumericLiteral(current->getOp1())) {
-                
-                // This temporary is defined by a constant - propagate its use
-                substituteSymbolUses(current->getNext(), current->getRes(), current->getOp1());
-                
-                // Now check if this MOVE is dead code after propagation
-                if (!isSymbolUsed(current->getNext(), current->getRes())) {
-                    // This is now dead code - remove it
-                    if (current->getPrev()) {
-                        current->getPrev()->setNext(current->getNext());
-                    } else {
-                        tacHead = current->getNext(); // Update head if this was the first instruction
-                    }
-                    
-                    if (current->getNext()) {
-                        current->getNext()->setPrev(current->getPrev());
-                    }
-                    
-                    TAC* toDelete = current;
-                    current = current->getNext();
-                    delete toDelete;
-                    
-                    optimized = true;
-                    passOptimizations++;
-                    hasOptimizations = true;
-                    continue; // Skip the rest of the loop since we moved to next instruction
-                }
-            }
-            
-            // Third, check for binary operations with constant operands (including constant propagation)
+            // Fold operations whose operands are all numeric literals (constants reach them through copy propagation)
             switch (current->getType()) {
                 case TACType::ADD:
                 case TACType::SUB:
@@ -288,34 +230,22 @@ TAC* optimizeConstantFolding(TAC* tacHead) {
                 case TACType::NE:
                 case TACType::AND:
                 case TACType::OR: {
-                    Symbol* op1 = current->getOp1();
-                    Symbol* op2 = current->getOp2();
-                    
-                    // Try to propagate constants for operands that are temporaries
-                    Symbol* effectiveOp1 = op1;
-                    Symbol* effectiveOp2 = op2;
-                    
-                    // Check if op1 is a temporary with a constant value
-                    if (op1 && !isNumericLiteral(op1)) {
-                        Symbol* constVal = findConstantValue(tacHead, op1);
-                        if (constVal) {
-                            effectiveOp1 = constVal;
-                        }
-                    }
+                    Symbol* effectiveOp1 = current->getOp1();
+                    Symbol* effectiveOp2 = current->getOp2();
                     
-                    // Check if op2 is a temporary with a constant value
-                    if (op2 && !isNumericLiteral(op2)) {
-                        Symbol* constVal = findConstantValue(tacHead, op2);
-                        if (constVal) {
-                            effectiveOp2 = constVal;
+                    if (isNumericLiteral(effectiveOp1) && isNumericLiteral(effectiveOp2) &&
+                        !isTrappingDivision(effectiveOp1, effectiveOp2, current->getType())) {
+                        // Both operands are numeric literals - perform constant folding, in 32-bit integers
+                        // when both are integers so overflows wrap around like the machine instructions
+                        double result = 0.0;
+                        if (effectiveOp1->getType() == LIT_INT && effectiveOp2->getType() == LIT_INT) {
+                            result = computeIntegerExpression(getIntegerValue(effectiveOp1), getIntegerValue(effectiveOp2),
+                                                              current->getType());
+                        } else {
+                            double val1 = getNumericValue(effectiveOp1);
+                            double val2 = getNumericValue(effectiveOp2);
+                            result = computeConstantExpression(val1, val2, current->getType());
                         }
-                    }
-                    
-                    if (isNumericLiteral(effectiveOp1) && isNumericLiteral(effectiveOp2)) {
-                        // Both operands are numeric literals (after propagation) - perform constant folding
-                        double val1 = getNumericValue(effectiveOp1);
-                        double val2 = getNumericValue(effectiveOp2);
-                        double result = computeConstantExpression(val1, val2, current->getType());
                         
                         // Determine result data type
                         dataType resultType = getResultDataType(effectiveOp1, effectiveOp2, current->getType());
@@ -355,21 +285,10 @@ TAC* optimizeConstantFolding(TAC* tacHead) {
                 }
                 
                 case TACType::NOT: {
-                    Symbol* op1 = current->getOp1();
-                    
-                    // Try to propagate constant for operand that is a temporary
-                    Symbol* effectiveOp1 = op1;
-                    
-                    // Check if op1 is a temporary with a constant value
-                    if (op1 && !isNumericLiteral(op1)) {
-                        Symbol* constVal = findConstantValue(tacHead, op1);
-                        if (constVal) {
-                            effectiveOp1 = constVal;
-                        }
-                    }
+                    Symbol* effectiveOp1 = current->getOp1();
                     
                     if (isNumericLiteral(effectiveOp1)) {
-                        // Unary operation with constant operand (after propagation)
+                        // Unary operation with constant operand
                         double val1 = getNumericValue(effectiveOp1);
                         double result = computeUnaryConstantExpression(val1, current->getType());
                         
@@ -433,14 +352,1573 @@ TAC* optimizeConstantFolding(TAC* tacHead) {
     return tacHead;
 }
 
-// Main optimization function
-TAC* optimizeTAC(TAC* tacHead, const std::string& outputFileName) {
-    if (!tacHead) {
-        return nullptr;
-    }  
-    
-    // Apply constant folding optimization
-    TAC* optimizedTac = optimizeConstantFolding(tacHead);
+// Helper function to check if a symbol is the integer literal with the given value
+bool isIntegerConstant(Symbol* symbol, int value) {
+    return isNumericLiteral(symbol) && symbol->getType() == LIT_INT &&
+           getNumericValue(symbol) == static_cast<double>(value);
+}
+
+// Helper function to turn an instruction into "res = value"
+void rewriteAsMove(TAC* tac, Symbol* value) {
+    tac->setType(TACType::MOVE);
+    tac->setOp1(value);
+    tac->setOp2(nullptr);
+}
+
+// Helper function to apply algebraic identities to one instruction, returns true if it was rewritten
+bool simplifyInstruction(TAC* tac) {
+    Symbol* op1 = tac->getOp1();
+    Symbol* op2 = tac->getOp2();
+    Symbol* zero = createConstantSymbol(0, dataType::INT);
+    Symbol* one = createConstantSymbol(1, dataType::INT);
+
+    switch (tac->getType()) {
+        case TACType::ADD:
+            if (isIntegerConstant(op2, 0)) { rewriteAsMove(tac, op1); return true; }
+            if (isIntegerConstant(op1, 0)) { rewriteAsMove(tac, op2); return true; }
+            return false;
+        case TACType::SUB:
+            if (isIntegerConstant(op2, 0)) { rewriteAsMove(tac, op1); return true; }
+            if (op1 == op2) { rewriteAsMove(tac, zero); return true; }
+            return false;
+        case TACType::MUL:
+            if (isIntegerConstant(op1, 0) || isIntegerConstant(op2, 0)) { rewriteAsMove(tac, zero); return true; }
+            if (isIntegerConstant(op2, 1)) { rewriteAsMove(tac, op1); return true; }
+            if (isIntegerConstant(op1, 1)) { rewriteAsMove(tac, op2); return true; }
+            if (isIntegerConstant(op2, -1) || isIntegerConstant(op1, -1)) {
+                tac->setType(TACType::SUB);
+                tac->setOp2(isIntegerConstant(op2, -1) ? op1 : op2);
+                tac->setOp1(zero);
+                return true;
+            }
+            return false;
+        case TACType::DIV:
+            // Divisions by -1 stay: idivl traps for INT32_MIN / -1, and the optimized program must trap too
+            if (isIntegerConstant(op2, 1)) { rewriteAsMove(tac, op1); return true; }
+            return false;
+        case TACType::MOD:
+            if (isIntegerConstant(op2, 1)) { rewriteAsMove(tac, zero); return true; }
+            return false;
+        case TACType::AND:
+            if (isIntegerConstant(op1, 0) || isIntegerConstant(op2, 0)) { rewriteAsMove(tac, zero); return true; }
+            return false;
+        case TACType::OR:
+            if ((isNumericLiteral(op1) && getNumericValue(op1) != 0.0) ||
+                (isNumericLiteral(op2) && getNumericValue(op2) != 0.0)) {
+                rewriteAsMove(tac, one);
+                return true;
+            }
+            return false;
+        case TACType::EQ:
+        case TACType::LE:
+        case TACType::GE:
+            if (op1 == op2) { rewriteAsMove(tac, one); return true; }
+            return false;
+        case TACType::NE:
+        case TACType::LT:
+        case TACType::GT:
+            if (op1 == op2) { rewriteAsMove(tac, zero); return true; }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// Algebraic simplification: removes operations with identity or absorbing operands (x+0, x*1, x*0, x-x, ...)
+TAC* optimizeAlgebraicSimplification(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int totalSimplified = 0;
+    for (TAC* current = tacHead; current; current = current->getNext()) {
+        if (simplifyInstruction(current)) {
+            totalSimplified++;
+        }
+    }
+
+    std::cout << "Algebraic simplification completed: " << totalSimplified
+              << " operations simplified." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to check if an instruction computes a value that only depends on its operands
+bool isValueNumberedOperation(TACType type) {
+    switch (type) {
+        case TACType::ADD:
+        case TACType::SUB:
+        case TACType::MUL:
+        case TACType::DIV:
+        case TACType::MOD:
+        case TACType::AND:
+        case TACType::OR:
+        case TACType::NOT:
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE:
+        case TACType::VECREAD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Helper function to check if the operands of an operation can be swapped
+bool isCommutativeOperation(TACType type) {
+    return type == TACType::ADD || type == TACType::MUL ||
+           type == TACType::EQ || type == TACType::NE ||
+           type == TACType::AND || type == TACType::OR;
+}
+
+// Value numbering state of one basic block
+struct ValueTable {
+    std::map<std::tuple<int, int, int>, int> expressions;   // (operation, left value, right value) to value number
+    std::unordered_map<Symbol*, int> symbolValues;          // Symbol to the value number it currently holds
+    std::unordered_map<int, Symbol*> holders;               // Value number to a symbol that may still hold it
+    int nextValue = 0;
+
+    int valueOf(Symbol* symbol) {
+        if (!symbol) return -1;
+        auto it = symbolValues.find(symbol);
+        if (it != symbolValues.end()) return it->second;
+        int value = nextValue++;
+        symbolValues[symbol] = value;
+        holders[value] = symbol;
+        return value;
+    }
+
+    // A holder is only valid while it was not reassigned
+    Symbol* holderOf(int value) {
+        auto it = holders.find(value);
+        if (it == holders.end()) return nullptr;
+        auto current = symbolValues.find(it->second);
+        if (current == symbolValues.end() || current->second != value) return nullptr;
+        return it->second;
+    }
+
+    // Rewrites an operand to the first symbol that still holds the same value
+    Symbol* canonical(Symbol* symbol) {
+        if (!symbol) return nullptr;
+        Symbol* holder = holderOf(valueOf(symbol));
+        return holder ? holder : symbol;
+    }
+
+    void assign(Symbol* symbol, int value) {
+        symbolValues[symbol] = value;
+        if (!holderOf(value)) {
+            holders[value] = symbol;
+        }
+    }
+
+    void assignNew(Symbol* symbol) {
+        int value = nextValue++;
+        symbolValues[symbol] = value;
+        holders[value] = symbol;
+    }
+
+    // Calls may write any global variable or vector, so only temporaries survive them
+    void killNonTemporaries() {
+        for (auto it = symbolValues.begin(); it != symbolValues.end();) {
+            if (it->first->getIdentifierType() != identifierType::TEMP) {
+                it = symbolValues.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+// Helper function to apply local value numbering to a single basic block
+int valueNumberBlock(BasicBlock& block) {
+    ValueTable table;
+    int eliminated = 0;
+
+    for (TAC* current : block.instructions) {
+        TACType type = current->getType();
+
+        // Operands are rewritten first, so copies of a value are recognized as the same value
+        switch (type) {
+            case TACType::VECREAD:
+                current->setOp2(table.canonical(current->getOp2()));
+                break;
+            case TACType::VECWRITE:
+            case TACType::MOVE:
+            case TACType::PRINT:
+            case TACType::ARG:
+            case TACType::IFZ:
+            case TACType::IFNZ:
+            case TACType::RET:
+            case TACType::NOT:
+                current->setOp1(table.canonical(current->getOp1()));
+                if (type == TACType::VECWRITE) {
+                    current->setOp2(table.canonical(current->getOp2()));
+                }
+                break;
+            default:
+                if (isValueNumberedOperation(type)) {
+                    current->setOp1(table.canonical(current->getOp1()));
+                    current->setOp2(table.canonical(current->getOp2()));
+                }
+                break;
+        }
+
+        if (isValueNumberedOperation(type)) {
+            int left = table.valueOf(current->getOp1());
+            int right = table.valueOf(current->getOp2());
+
+            // Normalize operand order so that a + b and b + a, or a < b and b > a, share a key
+            TACType keyType = type;
+            if (isCommutativeOperation(type) && right >= 0 && right < left) {
+                std::swap(left, right);
+            } else if (type == TACType::GT || type == TACType::GE) {
+                keyType = (type == TACType::GT) ? TACType::LT : TACType::LE;
+                std::swap(left, right);
+            }
+
+            std::tuple<int, int, int> key(static_cast<int>(keyType), left, right);
+            auto found = table.expressions.find(key);
+            Symbol* holder = (found != table.expressions.end()) ? table.holderOf(found->second) : nullptr;
+
+            if (holder && holder != current->getRes()) {
+                // Redundant computation - reuse the symbol that already holds the value
+                current->setType(TACType::MOVE);
+                current->setOp1(holder);
+                current->setOp2(nullptr);
+                table.assign(current->getRes(), found->second);
+                eliminated++;
+            } else {
+                table.assignNew(current->getRes());
+                table.expressions[key] = table.symbolValues[current->getRes()];
+            }
+            continue;
+        }
+
+        switch (type) {
+            case TACType::MOVE:
+                table.assign(current->getRes(), table.valueOf(current->getOp1()));
+                break;
+            case TACType::VECWRITE: {
+                // Writing a vector invalidates every read from it, but the written element is now known
+                Symbol* vector = current->getRes();
+                table.symbolValues.erase(vector);
+                int index = table.valueOf(current->getOp1());
+                int value = table.valueOf(current->getOp2());
+                std::tuple<int, int, int> key(static_cast<int>(TACType::VECREAD), table.valueOf(vector), index);
+                table.expressions[key] = value;
+                break;
+            }
+            case TACType::READ:
+            case TACType::PARAM:
+            case TACType::SELECT:
+            case TACType::VECADDR:
+            case TACType::PTRREAD:
+            case TACType::PTRADD:
+                table.assignNew(current->getRes());
+                break;
+            case TACType::PTRWRITE:
+            case TACType::VECLOOP:
+                // The written vectors and variables are not explicit here, so forget every one of them
+                table.killNonTemporaries();
+                break;
+            case TACType::CALL:
+                table.killNonTemporaries();
+                if (current->getRes()) {
+                    table.assignNew(current->getRes());
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return eliminated;
+}
+
+// Local value numbering: reuses values already computed inside the same basic block
+TAC* optimizeLocalValueNumbering(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int totalEliminated = 0;
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    for (FunctionCFG& cfg : functions) {
+        for (BasicBlock& block : cfg.blocks) {
+            totalEliminated += valueNumberBlock(block);
+        }
+    }
+
+    std::cout << "Local value numbering completed: " << totalEliminated
+              << " redundant expressions eliminated." << std::endl;
+
+    return tacHead;
+}
+
+// Available copies at a program point: copied variable to the value it holds
+typedef std::map<Symbol*, Symbol*> CopyMap;
+
+// Helper function to check if a symbol may be the source of a propagated copy
+bool isCopySource(Symbol* symbol) {
+    if (!symbol) return false;
+
+    if (isVariableSymbol(symbol)) {
+        return symbol->getIdentifierType() != identifierType::VECTOR;
+    }
+    return isNumericLiteral(symbol) || symbol->getType() == LIT_CHAR;
+}
+
+// Helper function to forget every copy that reads or writes a symbol
+void killCopies(CopyMap& copies, Symbol* symbol) {
+    for (auto it = copies.begin(); it != copies.end();) {
+        if (it->first == symbol || it->second == symbol) {
+            it = copies.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Helper function to replace an operand by the value it is a copy of
+Symbol* resolveCopy(const CopyMap& copies, Symbol* symbol) {
+    auto it = copies.find(symbol);
+    return it != copies.end() ? it->second : symbol;
+}
+
+// Helper function to rewrite the operands of an instruction with the available copies
+int substituteCopies(TAC* tac, const CopyMap& copies) {
+    int replaced = 0;
+    Symbol* op1 = tac->getOp1();
+    Symbol* op2 = tac->getOp2();
+
+    switch (tac->getType()) {
+        case TACType::MOVE:
+        case TACType::NOT:
+        case TACType::IFZ:
+        case TACType::IFNZ:
+        case TACType::RET:
+        case TACType::PRINT:
+        case TACType::ARG:
+            tac->setOp1(resolveCopy(copies, op1));
+            break;
+        case TACType::VECREAD:
+            tac->setOp2(resolveCopy(copies, op2));
+            break;
+        case TACType::VECWRITE:
+        case TACType::SELECT:
+            tac->setOp1(resolveCopy(copies, op1));
+            tac->setOp2(resolveCopy(copies, op2));
+            break;
+        default:
+            if (isValueNumberedOperation(tac->getType())) {
+                tac->setOp1(resolveCopy(copies, op1));
+                tac->setOp2(resolveCopy(copies, op2));
+            }
+            break;
+    }
+
+    if (tac->getOp1() != op1) replaced++;
+    if (tac->getOp2() != op2) replaced++;
+    return replaced;
+}
+
+// Helper function to step the available copies over one instruction, optionally rewriting it
+int transferCopies(TAC* tac, const FunctionCFG& cfg, CopyMap& copies, bool rewrite) {
+    int replaced = 0;
+    if (rewrite) {
+        replaced = substituteCopies(tac, copies);
+    }
+
+    // The callee may write any global variable
+    if (tac->getType() == TACType::CALL) {
+        for (Symbol* global : cfg.globals) {
+            killCopies(copies, global);
+        }
+    }
+
+    // A vectorized loop writes its counter and accumulators
+    if (tac->getType() == TACType::VECLOOP) {
+        for (Symbol* operand : getUsedSymbols(tac)) {
+            killCopies(copies, operand);
+        }
+    }
+
+    Symbol* defined = getDefinedSymbol(tac);
+    if (defined) {
+        killCopies(copies, defined);
+        if (tac->getType() == TACType::MOVE && defined->getIdentifierType() != identifierType::VECTOR) {
+            Symbol* source = resolveCopy(copies, tac->getOp1());
+            if (source != defined && isCopySource(source)) {
+                copies[defined] = source;
+            }
+        }
+    }
+
+    return replaced;
+}
+
+// Helper function to propagate copies inside one function using the copies available on every path
+int propagateFunctionCopies(FunctionCFG& cfg) {
+    size_t blockCount = cfg.blocks.size();
+    std::vector<CopyMap> copiesOut(blockCount);
+    std::vector<bool> reached(blockCount, false);
+
+    // Copies available at the start of a block: intersection over the predecessors already reached
+    auto blockEntry = [&](size_t i) {
+        CopyMap copies;
+        if (i == 0) return copies;
+
+        bool first = true;
+        for (int predecessor : cfg.blocks[i].predecessors) {
+            if (!reached[predecessor]) continue;
+            if (first) {
+                copies = copiesOut[predecessor];
+                first = false;
+                continue;
+            }
+            for (auto it = copies.begin(); it != copies.end();) {
+                auto other = copiesOut[predecessor].find(it->first);
+                if (other == copiesOut[predecessor].end() || other->second != it->second) {
+                    it = copies.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return copies;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < blockCount; i++) {
+            CopyMap copies = blockEntry(i);
+            for (TAC* tac : cfg.blocks[i].instructions) {
+                transferCopies(tac, cfg, copies, false);
+            }
+            if (!reached[i] || copies != copiesOut[i]) {
+                reached[i] = true;
+                copiesOut[i] = copies;
+                changed = true;
+            }
+        }
+    }
+
+    int replaced = 0;
+    for (size_t i = 0; i < blockCount; i++) {
+        CopyMap copies = blockEntry(i);
+        for (TAC* tac : cfg.blocks[i].instructions) {
+            replaced += transferCopies(tac, cfg, copies, true);
+        }
+    }
+
+    return replaced;
+}
+
+// Global copy propagation: uses the original value instead of the copies made by MOVE
+TAC* optimizeCopyPropagation(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int totalReplaced = 0;
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    for (FunctionCFG& cfg : functions) {
+        totalReplaced += propagateFunctionCopies(cfg);
+    }
+
+    std::cout << "Copy propagation completed: " << totalReplaced
+              << " operands replaced." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to check if an instruction may be executed on paths where it did not run before
+bool isSafeToSpeculate(TAC* tac, const std::map<Symbol*, int>& vectorSizes) {
+    switch (tac->getType()) {
+        case TACType::DIV:
+        case TACType::MOD:
+            // Division by a variable may trap when the loop would not have executed it
+            return isNumericLiteral(tac->getOp2()) && getNumericValue(tac->getOp2()) != 0.0;
+        case TACType::VECREAD: {
+            // Only reads whose index is known to be inside the vector
+            auto size = vectorSizes.find(tac->getOp1());
+            if (!isNumericLiteral(tac->getOp2()) || size == vectorSizes.end()) return false;
+            double index = getNumericValue(tac->getOp2());
+            return index >= 0.0 && index < static_cast<double>(size->second);
+        }
+        default:
+            return true;
+    }
+}
+
+// Helper function to hoist the invariant computations of one loop to a preheader, returns how many were moved
+int hoistLoopInvariants(FunctionCFG& cfg, const NaturalLoop& loop, const std::vector<std::vector<bool>>& dominators,
+                        const Liveness& liveness, const std::map<Symbol*, int>& vectorSizes) {
+    if (!findPreheaderPosition(cfg, loop)) return 0;
+
+    // Definitions of the whole function and of the loop
+    std::map<Symbol*, int> functionDefinitions;
+    std::map<Symbol*, int> loopDefinitions;
+    std::set<Symbol*> writtenVectors;
+    bool hasCall = false;
+    for (const BasicBlock& block : cfg.blocks) {
+        bool inLoop = loop.blocks.count(block.id) > 0;
+        for (TAC* tac : block.instructions) {
+            Symbol* defined = getDefinedSymbol(tac);
+            if (defined) {
+                functionDefinitions[defined]++;
+                if (inLoop) loopDefinitions[defined]++;
+            }
+            if (inLoop && tac->getType() == TACType::VECWRITE) writtenVectors.insert(tac->getRes());
+            if (inLoop && tac->getType() == TACType::CALL) hasCall = true;
+        }
+    }
+
+    // Blocks that leave the loop, and the blocks they leave to
+    std::vector<int> exitingBlocks;
+    std::set<int> exitTargets;
+    for (int id : loop.blocks) {
+        const BasicBlock& block = cfg.blocks[id];
+        bool exits = block.successors.empty();
+        for (int successor : block.successors) {
+            if (!loop.blocks.count(successor)) {
+                exits = true;
+                exitTargets.insert(successor);
+            }
+        }
+        if (exits) exitingBlocks.push_back(id);
+    }
+
+    std::set<Symbol*> invariantTemps;
+    auto isInvariantOperand = [&](Symbol* symbol) {
+        if (!isVariableSymbol(symbol)) return true;
+        if (invariantTemps.count(symbol)) return true;
+        if (loopDefinitions.count(symbol)) return false;
+        // Calls may write any global variable
+        return !(hasCall && cfg.globals.count(symbol));
+    };
+
+    std::vector<TAC*> hoisted;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int id : loop.blocks) {
+            for (TAC* tac : cfg.blocks[id].instructions) {
+                if (tac->getType() != TACType::MOVE && !isValueNumberedOperation(tac->getType())) continue;
+
+                // Single definition temporaries only, not read before the loop computes them or after it exits
+                Symbol* result = tac->getRes();
+                if (!result || result->getIdentifierType() != identifierType::TEMP) continue;
+                if (invariantTemps.count(result) || functionDefinitions[result] != 1) continue;
+                if (liveness.liveIn[loop.header].count(result)) continue;
+                bool liveAtExit = false;
+                for (int target : exitTargets) {
+                    if (liveness.liveIn[target].count(result)) liveAtExit = true;
+                }
+                if (liveAtExit) continue;
+
+                if (tac->getType() == TACType::VECREAD) {
+                    if (hasCall || writtenVectors.count(tac->getOp1())) continue;
+                    if (!isInvariantOperand(tac->getOp2())) continue;
+                } else {
+                    if (!isInvariantOperand(tac->getOp1()) || !isInvariantOperand(tac->getOp2())) continue;
+                }
+
+                // Instructions that may trap must run on every iteration that leaves the loop
+                if (!isSafeToSpeculate(tac, vectorSizes)) {
+                    bool dominatesExits = true;
+                    for (int exiting : exitingBlocks) {
+                        if (!dominators[exiting][id]) dominatesExits = false;
+                    }
+                    if (!dominatesExits) continue;
+                }
+
+                invariantTemps.insert(result);
+                hoisted.push_back(tac);
+                changed = true;
+            }
+        }
+    }
+
+    if (hoisted.empty()) return 0;
+
+    for (TAC* tac : hoisted) {
+        tacUnlink(tac);
+    }
+    insertPreheader(cfg, loop, hoisted);
+
+    return static_cast<int>(hoisted.size());
+}
+
+// Loop invariant code motion: moves computations that give the same value on every iteration out of loops
+TAC* optimizeLoopInvariantCodeMotion(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    // Vector sizes bound the indexes that can be read speculatively
+    std::map<Symbol*, int> vectorSizes;
+    for (TAC* current = tacHead; current; current = current->getNext()) {
+        if (current->getType() == TACType::BEGINVEC && isNumericLiteral(current->getOp2())) {
+            vectorSizes[current->getOp1()] = static_cast<int>(getNumericValue(current->getOp2()));
+        }
+    }
+
+    int totalHoisted = 0;
+    int loopsOptimized = 0;
+    bool changed = true;
+
+    // The CFG is rebuilt after each change, so outer loops see what was hoisted from inner ones
+    while (changed) {
+        changed = false;
+        std::vector<FunctionCFG> functions = buildCFG(tacHead);
+        for (FunctionCFG& cfg : functions) {
+            std::vector<std::vector<bool>> dominators = computeDominators(cfg);
+            Liveness liveness = computeLiveness(cfg);
+            for (const NaturalLoop& loop : findNaturalLoops(cfg, dominators)) {
+                int hoisted = hoistLoopInvariants(cfg, loop, dominators, liveness, vectorSizes);
+                if (hoisted > 0) {
+                    totalHoisted += hoisted;
+                    loopsOptimized++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::cout << "Loop invariant code motion completed: " << totalHoisted
+              << " instructions hoisted from " << loopsOptimized << " loops." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to get the step of an update "i = i + c" or "i = i - c" with an integer literal c
+// The update may also be "t = i + c" followed by "i = t" when t is still read afterwards
+bool getInductionStep(TAC* tac, int& step) {
+    TAC* update = tac;
+    if (tac->getType() == TACType::MOVE) {
+        update = tac->getPrev();
+        if (!update || update->getRes() != tac->getOp1()) return false;
+        if (update->getOp1() != tac->getRes()) return false;
+    } else if (tac->getOp1() != tac->getRes()) {
+        return false;
+    }
+
+    if (update->getType() != TACType::ADD && update->getType() != TACType::SUB) return false;
+    if (!isNumericLiteral(update->getOp2()) || update->getOp2()->getType() != LIT_INT) return false;
+
+    step = static_cast<int>(getNumericValue(update->getOp2()));
+    if (update->getType() == TACType::SUB) step = -step;
+    return true;
+}
+
+// Helper function to rewrite the vector accesses indexed by basic induction variables of one loop into pointers
+int rewriteLoopVectorAccesses(FunctionCFG& cfg, const NaturalLoop& loop, const std::vector<NaturalLoop>& loops,
+                              const std::vector<std::vector<bool>>& dominators) {
+    // Only innermost loops, so every update runs exactly once per iteration of this loop
+    for (const NaturalLoop& other : loops) {
+        if (other.header != loop.header && loop.blocks.count(other.header)) return 0;
+    }
+    if (!findPreheaderPosition(cfg, loop)) return 0;
+
+    std::map<Symbol*, int> loopDefinitions;
+    std::map<Symbol*, TAC*> updates;
+    bool hasCall = false;
+    for (int id : loop.blocks) {
+        for (TAC* tac : cfg.blocks[id].instructions) {
+            Symbol* defined = getDefinedSymbol(tac);
+            if (defined) {
+                loopDefinitions[defined]++;
+                updates[defined] = tac;
+            }
+            if (tac->getType() == TACType::CALL) hasCall = true;
+        }
+    }
+
+    // Basic induction variables: a single "i = i +- c" in a block that runs on every iteration
+    std::map<Symbol*, int> steps;
+    std::map<Symbol*, int> updateBlocks;
+    for (int id : loop.blocks) {
+        for (TAC* tac : cfg.blocks[id].instructions) {
+            int step = 0;
+            Symbol* variable = tac->getRes();
+            if (!getInductionStep(tac, step) || loopDefinitions[variable] != 1) continue;
+            if (hasCall && cfg.globals.count(variable)) continue;
+
+            bool dominatesLatches = true;
+            for (int predecessor : cfg.blocks[loop.header].predecessors) {
+                if (loop.blocks.count(predecessor) && !dominators[predecessor][id]) dominatesLatches = false;
+            }
+            if (!dominatesLatches) continue;
+
+            steps[variable] = step;
+            updateBlocks[variable] = id;
+        }
+    }
+    if (steps.empty()) return 0;
+
+    // One pointer per (vector, induction variable) pair, kept equal to &vector[variable]
+    std::map<std::pair<Symbol*, Symbol*>, Symbol*> pointers;
+    std::vector<TAC*> preheader;
+    int rewritten = 0;
+    for (int id : loop.blocks) {
+        for (TAC* tac : cfg.blocks[id].instructions) {
+            Symbol* vector = nullptr;
+            Symbol* index = nullptr;
+            if (tac->getType() == TACType::VECREAD) {
+                vector = tac->getOp1();
+                index = tac->getOp2();
+            } else if (tac->getType() == TACType::VECWRITE) {
+                vector = tac->getRes();
+                index = tac->getOp1();
+            }
+            if (!vector || !steps.count(index)) continue;
+
+            std::pair<Symbol*, Symbol*> key(vector, index);
+            Symbol* pointer = pointers[key];
+            if (!pointer) {
+                pointer = makeTemp(dataType::ADDRESS);
+                pointers[key] = pointer;
+                preheader.push_back(new TAC(TACType::VECADDR, pointer, vector, index));
+                Symbol* stride = createConstantSymbol(steps[index], dataType::INT);
+                tacInsertAfter(updates[index], new TAC(TACType::PTRADD, pointer, pointer, stride));
+            }
+
+            if (tac->getType() == TACType::VECREAD) {
+                tac->setType(TACType::PTRREAD);
+                tac->setOp1(pointer);
+                tac->setOp2(nullptr);
+            } else {
+                Symbol* value = tac->getOp2();
+                tac->setType(TACType::PTRWRITE);
+                tac->setRes(pointer);
+                tac->setOp1(value);
+                tac->setOp2(nullptr);
+            }
+            rewritten++;
+        }
+    }
+
+    if (!preheader.empty()) {
+        insertPreheader(cfg, loop, preheader);
+    }
+    return rewritten;
+}
+
+// Induction variable optimization: vector accesses indexed by a loop counter walk a pointer instead
+TAC* optimizeInductionVariables(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int totalRewritten = 0;
+    int loopsOptimized = 0;
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    for (FunctionCFG& cfg : functions) {
+        std::vector<std::vector<bool>> dominators = computeDominators(cfg);
+        std::vector<NaturalLoop> loops = findNaturalLoops(cfg, dominators);
+        for (const NaturalLoop& loop : loops) {
+            int rewritten = rewriteLoopVectorAccesses(cfg, loop, loops, dominators);
+            if (rewritten > 0) {
+                totalRewritten += rewritten;
+                loopsOptimized++;
+            }
+        }
+    }
+
+    std::cout << "Induction variable optimization completed: " << totalRewritten
+              << " vector accesses rewritten to pointers in " << loopsOptimized << " loops." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to check if an instruction can be removed when its result is never read
+bool isPureInstruction(TAC* tac) {
+    return tac->getType() == TACType::MOVE || isValueNumberedOperation(tac->getType()) ||
+           tac->getType() == TACType::VECADDR || tac->getType() == TACType::PTRREAD ||
+           tac->getType() == TACType::PTRADD;
+}
+
+// Helper function to remove dead instructions of one function and write results straight to their copy
+int eliminateFunctionDeadCode(FunctionCFG& cfg, int& coalesced) {
+    Liveness liveness = computeLiveness(cfg);
+    int removed = 0;
+
+    for (size_t i = 0; i < cfg.blocks.size(); i++) {
+        std::vector<TAC*>& instructions = cfg.blocks[i].instructions;
+        std::set<Symbol*> live = liveness.liveOut[i];
+        TAC* following = nullptr;
+        std::set<Symbol*> liveAfterFollowing;
+
+        for (size_t j = instructions.size(); j-- > 0;) {
+            TAC* tac = instructions[j];
+            Symbol* defined = getDefinedSymbol(tac);
+
+            bool selfMove = tac->getType() == TACType::MOVE && tac->getOp1() == tac->getRes();
+            if (isPureInstruction(tac) && defined && (selfMove || live.find(defined) == live.end())) {
+                tacUnlink(tac);
+                delete tac;
+                removed++;
+                continue;
+            }
+
+            // "t = a op b; x = t" with t dead afterwards becomes "x = a op b"
+            if (defined && defined->getIdentifierType() == identifierType::TEMP && tac->getType() != TACType::SELECT && following &&
+                following->getType() == TACType::MOVE && following->getOp1() == defined &&
+                getDefinedSymbol(following) &&
+                following->getRes()->getIdentifierType() != identifierType::VECTOR &&
+                liveAfterFollowing.find(defined) == liveAfterFollowing.end()) {
+                tac->setRes(following->getRes());
+                tacUnlink(following);
+                delete following;
+                live = liveAfterFollowing;
+                coalesced++;
+            }
+
+            std::set<Symbol*> liveAfter = live;
+            updateLiveness(tac, cfg, live);
+            following = tac;
+            liveAfterFollowing = liveAfter;
+        }
+    }
+
+    return removed;
+}
+
+// Dead code elimination: removes pure instructions whose results are not live
+TAC* optimizeDeadCodeElimination(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int totalRemoved = 0;
+    int totalCoalesced = 0;
+    int passes = 0;
+    bool changed = true;
+
+    // Removing an instruction may make the definitions of its operands dead as well
+    while (changed) {
+        changed = false;
+        passes++;
+        std::vector<FunctionCFG> functions = buildCFG(tacHead);
+        for (FunctionCFG& cfg : functions) {
+            int coalesced = 0;
+            int removed = eliminateFunctionDeadCode(cfg, coalesced);
+            if (removed > 0 || coalesced > 0) changed = true;
+            totalRemoved += removed;
+            totalCoalesced += coalesced;
+        }
+    }
+
+    std::cout << "Dead code elimination completed: " << totalRemoved << " instructions removed and "
+              << totalCoalesced << " copies coalesced in " << passes << " passes." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to get the first instruction at or after tac that is not a label
+TAC* skipLabels(TAC* tac) {
+    while (tac && tac->getType() == TACType::LABEL) {
+        tac = tac->getNext();
+    }
+    return tac;
+}
+
+// Helper function to check if a label is placed between tac and the next instruction that is not a label
+bool isLabelRightAfter(TAC* tac, Symbol* label) {
+    for (TAC* current = tac->getNext(); current && current->getType() == TACType::LABEL; current = current->getNext()) {
+        if (current->getOp1() == label) return true;
+    }
+    return false;
+}
+
+// Counters of the control flow cleanup
+struct ControlFlowStats {
+    int branchesFolded = 0;
+    int jumpsThreaded = 0;
+    int jumpsRemoved = 0;
+    int unreachableRemoved = 0;
+    int labelsRemoved = 0;
+};
+
+// Helper function to fold branches on constants, thread jumps to jumps and drop jumps to the next instruction
+bool simplifyBranches(TAC* tacHead, ControlFlowStats& stats) {
+    bool changed = false;
+    std::unordered_map<Symbol*, TAC*> labels;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() == TACType::LABEL) labels[tac->getOp1()] = tac;
+    }
+
+    TAC* current = tacHead;
+    while (current) {
+        TAC* next = current->getNext();
+
+        // IFZ and IFNZ on a constant either always jump or never do
+        bool isBranch = current->getType() == TACType::IFZ || current->getType() == TACType::IFNZ;
+        if (isBranch && isNumericLiteral(current->getOp1())) {
+            if ((getNumericValue(current->getOp1()) == 0) == (current->getType() == TACType::IFZ)) {
+                current->setType(TACType::JUMP);
+                current->setOp1(current->getOp2());
+                current->setOp2(nullptr);
+            } else {
+                tacUnlink(current);
+                delete current;
+                stats.branchesFolded++;
+                changed = true;
+                current = next;
+                continue;
+            }
+            stats.branchesFolded++;
+            changed = true;
+        }
+
+        if (current->getType() == TACType::JUMP || current->getType() == TACType::IFZ ||
+            current->getType() == TACType::IFNZ) {
+            bool isJump = current->getType() == TACType::JUMP;
+            Symbol* target = isJump ? current->getOp1() : current->getOp2();
+
+            // Follow chains of labels that only jump somewhere else (bounded, in case of a cycle)
+            Symbol* threaded = target;
+            for (size_t hops = 0; hops < labels.size(); hops++) {
+                auto label = labels.find(threaded);
+                if (label == labels.end()) break;
+                TAC* destination = skipLabels(label->second);
+                if (!destination || destination->getType() != TACType::JUMP || destination->getOp1() == threaded) break;
+                threaded = destination->getOp1();
+            }
+            if (threaded != target) {
+                if (isJump) current->setOp1(threaded);
+                else current->setOp2(threaded);
+                target = threaded;
+                stats.jumpsThreaded++;
+                changed = true;
+            }
+
+            // Both ways of a jump to the next instruction end up at the same place
+            if (isLabelRightAfter(current, target)) {
+                tacUnlink(current);
+                delete current;
+                stats.jumpsRemoved++;
+                changed = true;
+            }
+        }
+        current = next;
+    }
+    return changed;
+}
+
+// Helper function to remove the blocks of a function that can not be reached from its entry
+int removeUnreachableBlocks(FunctionCFG& cfg) {
+    int removed = 0;
+    std::vector<bool> reachable = findReachableBlocks(cfg);
+    for (size_t i = 0; i < cfg.blocks.size(); i++) {
+        if (reachable[i]) continue;
+        for (TAC* tac : cfg.blocks[i].instructions) {
+            tacUnlink(tac);
+            delete tac;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+// Helper function to remove labels that no jump refers to, merging their block with the previous one
+int removeUnusedLabels(TAC* tacHead) {
+    std::set<Symbol*> targets;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() == TACType::LABEL) continue;
+        if (tac->getOp1()) targets.insert(tac->getOp1());
+        if (tac->getOp2()) targets.insert(tac->getOp2());
+        for (Symbol* target : getJumpTableTargets(tac)) {
+            targets.insert(target);
+        }
+    }
+
+    int removed = 0;
+    TAC* current = tacHead;
+    while (current) {
+        TAC* next = current->getNext();
+        if (current->getType() == TACType::LABEL && !targets.count(current->getOp1())) {
+            tacUnlink(current);
+            delete current;
+            removed++;
+        }
+        current = next;
+    }
+    return removed;
+}
+
+// Control flow cleanup: folds constant branches, threads jumps and removes unreachable code and unused labels
+TAC* optimizeControlFlow(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    ControlFlowStats stats;
+    bool changed = true;
+    while (changed) {
+        changed = simplifyBranches(tacHead, stats);
+
+        std::vector<FunctionCFG> functions = buildCFG(tacHead);
+        for (FunctionCFG& cfg : functions) {
+            int removed = removeUnreachableBlocks(cfg);
+            if (removed > 0) changed = true;
+            stats.unreachableRemoved += removed;
+        }
+
+        int labels = removeUnusedLabels(tacHead);
+        if (labels > 0) changed = true;
+        stats.labelsRemoved += labels;
+    }
+
+    std::cout << "Control flow cleanup completed: " << stats.branchesFolded << " branches folded, "
+              << stats.jumpsThreaded << " jumps threaded, " << stats.jumpsRemoved << " jumps removed, "
+              << stats.unreachableRemoved << " unreachable instructions and " << stats.labelsRemoved
+              << " labels removed." << std::endl;
+
+    return tacHead;
+}
+
+// Instructions each side of a branch may have to be turned into a select: executing both sides
+// must stay cheaper than the branch mispredictions it removes
+const int MAX_SELECT_ARM = 3;
+
+// Helper function to check if an instruction can run on a path that did not take it (no side effects, no traps)
+bool isSpeculatable(TAC* tac) {
+    if (tac->getType() == TACType::MOVE) return true;
+    return isValueNumberedOperation(tac->getType()) && tac->getType() != TACType::DIV && tac->getType() != TACType::MOD &&
+           tac->getType() != TACType::VECREAD;
+}
+
+// Helper function to collect one side of a branch: speculatable instructions that compute temps, the last one
+// assigning the variable the branch chooses. Returns the first instruction after the side (nullptr if it does not fit)
+TAC* collectSelectArm(TAC* first, std::vector<TAC*>& arm) {
+    TAC* tac = first;
+    while (tac && isSpeculatable(tac) && arm.size() <= (size_t)MAX_SELECT_ARM) {
+        arm.push_back(tac);
+        tac = tac->getNext();
+    }
+    if (arm.empty() || arm.size() > (size_t)MAX_SELECT_ARM || !getDefinedSymbol(arm.back()) ||
+        arm.back()->getRes()->getIdentifierType() == identifierType::VECTOR) {
+        arm.clear();
+        return nullptr;
+    }
+    for (size_t i = 0; i + 1 < arm.size(); i++) {
+        if (getDefinedSymbol(arm[i])->getIdentifierType() != identifierType::TEMP) {
+            arm.clear();
+            return nullptr;
+        }
+    }
+    return tac;
+}
+
+// Helper function to check that one side can run before the condition is computed: only its final copy may read
+// the condition, and the temps it computes are not read by the other side
+bool isArmIndependent(const std::vector<TAC*>& arm, const std::vector<TAC*>& other, Symbol* condition) {
+    for (size_t i = 0; i < arm.size(); i++) {
+        if (i + 1 == arm.size() && arm[i]->getType() == TACType::MOVE) break;
+        Symbol* defined = getDefinedSymbol(arm[i]);
+        if (defined == condition) return false;
+        for (Symbol* used : getUsedSymbols(arm[i])) {
+            if (used == condition) return false;
+        }
+        if (i + 1 == arm.size()) break;
+        for (TAC* tac : other) {
+            for (Symbol* used : getUsedSymbols(tac)) {
+                if (used == defined) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Helper function to move a side before the branch and its comparison, returning the value it assigns:
+// the source of its final copy (which is removed) or a new temp its last instruction now computes
+Symbol* hoistArm(TAC* branch, const std::vector<TAC*>& arm) {
+    TAC* position = branch;
+    TAC* comparison = branch->getPrev();
+    if (comparison && getDefinedSymbol(comparison) == branch->getOp1()) position = comparison;
+
+    TAC* last = arm.back();
+    size_t count = arm.size();
+    Symbol* value = nullptr;
+    if (last->getType() == TACType::MOVE) {
+        value = last->getOp1();
+        tacUnlink(last);
+        delete last;
+        count--;
+    } else {
+        value = makeTemp(last->getRes()->getDataType());
+        last->setRes(value);
+    }
+    for (size_t i = 0; i < count; i++) {
+        tacUnlink(arm[i]);
+        tacInsertBefore(position, arm[i]);
+    }
+    return value;
+}
+
+// Helper function to replace a branch by "m = otherwise; m = chosen if condition", moving the comparison
+// that computes the condition next to the select so the backend can test it directly
+void emitSelect(TAC* branch, Symbol* target, Symbol* chosen, Symbol* otherwise) {
+    Symbol* condition = branch->getOp1();
+    TAC* comparison = branch->getPrev();
+    if (otherwise) tacInsertBefore(branch, new TAC(TACType::MOVE, target, otherwise));
+    if (comparison && getDefinedSymbol(comparison) == condition && isValueNumberedOperation(comparison->getType()) &&
+        comparison->getOp1() != target && comparison->getOp2() != target) {
+        tacUnlink(comparison);
+        tacInsertBefore(branch, comparison);
+    }
+    tacInsertBefore(branch, new TAC(TACType::SELECT, target, chosen, condition));
+    tacUnlink(branch);
+    delete branch;
+}
+
+// If conversion: small branches that only choose the value of one variable become SELECT (cmov in the assembly)
+// Diamond "IFZ c, E; a...; m = x; JUMP J; LABEL E; b...; m = y; LABEL J" -> "a...; b...; m = y; m = x if c"
+// Triangle "IFZ c, J; a...; m = x; LABEL J" -> "a...; m = x if c"
+TAC* optimizeIfConversion(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    std::map<Symbol*, int> labelUses;
+    for (TAC* tac = tacHead; tac; tac = tac->getNext()) {
+        if (tac->getType() == TACType::JUMP) labelUses[tac->getOp1()]++;
+        if (tac->getType() == TACType::IFZ || tac->getType() == TACType::IFNZ) labelUses[tac->getOp2()]++;
+        for (Symbol* target : getJumpTableTargets(tac)) {
+            labelUses[target]++;
+        }
+    }
+
+    int diamonds = 0;
+    int triangles = 0;
+    TAC* current = tacHead;
+    while (current) {
+        TAC* branch = current;
+        current = current->getNext();
+        if (branch->getType() != TACType::IFZ && branch->getType() != TACType::IFNZ) continue;
+        Symbol* condition = branch->getOp1();
+        Symbol* skipLabel = branch->getOp2();
+        if (labelUses[skipLabel] != 1) continue;
+
+        std::vector<TAC*> fallthrough;
+        TAC* after = collectSelectArm(branch->getNext(), fallthrough);
+        if (!after) continue;
+        Symbol* target = fallthrough.back()->getRes();
+        if (target == condition) continue;
+
+        // Triangle: the fall-through side runs when the condition is nonzero (IFZ only)
+        if (after->getType() == TACType::LABEL && after->getOp1() == skipLabel) {
+            if (branch->getType() != TACType::IFZ || !isArmIndependent(fallthrough, {}, condition)) continue;
+            Symbol* chosen = hoistArm(branch, fallthrough);
+            emitSelect(branch, target, chosen, nullptr);
+            labelUses[skipLabel] = 0;
+            triangles++;
+            current = after;
+            continue;
+        }
+
+        // Diamond: "JUMP J; LABEL E" between the sides, then the other side up to "LABEL J"
+        if (after->getType() != TACType::JUMP || !after->getNext() || after->getNext()->getType() != TACType::LABEL ||
+            after->getNext()->getOp1() != skipLabel || labelUses[after->getOp1()] != 1) {
+            continue;
+        }
+        TAC* jump = after;
+        TAC* elseLabel = jump->getNext();
+        Symbol* joinLabel = jump->getOp1();
+        std::vector<TAC*> taken;
+        TAC* join = collectSelectArm(elseLabel->getNext(), taken);
+        if (!join || join->getType() != TACType::LABEL || join->getOp1() != joinLabel || taken.back()->getRes() != target ||
+            !isArmIndependent(fallthrough, taken, condition) || !isArmIndependent(taken, fallthrough, condition)) {
+            continue;
+        }
+        // A final copy of the variable to itself keeps its value, which the select can not express after "m = otherwise"
+        TAC* chosenSide = branch->getType() == TACType::IFZ ? fallthrough.back() : taken.back();
+        if (chosenSide->getType() == TACType::MOVE && chosenSide->getOp1() == target) continue;
+
+        // Both sides run before the branch; IFZ takes the jump when the condition is zero, IFNZ when it is nonzero
+        Symbol* fallthroughValue = hoistArm(branch, fallthrough);
+        Symbol* takenValue = hoistArm(branch, taken);
+        Symbol* chosen = branch->getType() == TACType::IFZ ? fallthroughValue : takenValue;
+        Symbol* otherwise = branch->getType() == TACType::IFZ ? takenValue : fallthroughValue;
+        tacUnlink(jump);
+        delete jump;
+        tacUnlink(elseLabel);
+        delete elseLabel;
+        emitSelect(branch, target, chosen, otherwise);
+        labelUses[skipLabel] = 0;
+        labelUses[joinLabel] = 0;
+        diamonds++;
+        current = join;
+    }
+    int labels = removeUnusedLabels(tacHead);
+
+    std::cout << "If conversion completed: " << diamonds << " diamonds and " << triangles
+              << " triangles turned into selects, " << labels << " labels removed." << std::endl;
+
+    return tacHead;
+}
+
+// Helper function to rotate a loop "LABEL h; t = a op b; IFZ t, exit; body; JUMP h" into
+// "LABEL h; t = a op b; IFZ t, exit; LABEL b; body; t' = a op b; IFNZ t', b", so each iteration runs one branch
+bool rotateLoop(const FunctionCFG& cfg, const NaturalLoop& loop, std::map<Symbol*, int>& uses) {
+    // Header: the label, at most one pure instruction computing the condition and the exit test
+    const std::vector<TAC*>& header = cfg.blocks[loop.header].instructions;
+    if (header.size() < 2 || header.size() > 3) return false;
+    TAC* headerLabel = header.front();
+    TAC* exitTest = header.back();
+    TAC* condition = header.size() == 3 ? header[1] : nullptr;
+    if (headerLabel->getType() != TACType::LABEL || exitTest->getType() != TACType::IFZ) return false;
+    if (condition && (!isValueNumberedOperation(condition->getType()) || condition->getRes() != exitTest->getOp1() ||
+                      condition->getRes()->getIdentifierType() != identifierType::TEMP || uses[condition->getRes()] != 1)) {
+        return false;
+    }
+    auto exitBlock = cfg.labelBlocks.find(exitTest->getOp2());
+    if (exitBlock == cfg.labelBlocks.end() || loop.blocks.count(exitBlock->second)) return false;
+
+    // Blocks laid out contiguously from the header, ending with the back edge
+    int last = loop.header + static_cast<int>(loop.blocks.size()) - 1;
+    if (last >= static_cast<int>(cfg.blocks.size())) return false;
+    for (int id = loop.header; id <= last; id++) {
+        if (!loop.blocks.count(id)) return false;
+    }
+    TAC* backEdge = cfg.blocks[last].instructions.back();
+    if (backEdge->getType() != TACType::JUMP || backEdge->getOp1() != headerLabel->getOp1()) return false;
+
+    // Other jumps back to the header now go to the test at the bottom
+    Symbol* bodyLabel = makeLabel();
+    Symbol* continueLabel = nullptr;
+    for (int id = loop.header + 1; id <= last; id++) {
+        for (TAC* tac : cfg.blocks[id].instructions) {
+            if (tac == backEdge) continue;
+            bool isJump = tac->getType() == TACType::JUMP;
+            bool isBranch = tac->getType() == TACType::IFZ || tac->getType() == TACType::IFNZ;
+            if ((isJump && tac->getOp1() == headerLabel->getOp1()) || (isBranch && tac->getOp2() == headerLabel->getOp1())) {
+                if (!continueLabel) {
+                    continueLabel = makeLabel();
+                    tacInsertBefore(backEdge, new TAC(TACType::LABEL, nullptr, continueLabel));
+                }
+                if (isJump) tac->setOp1(continueLabel);
+                else tac->setOp2(continueLabel);
+            }
+        }
+    }
+
+    tacInsertAfter(exitTest, new TAC(TACType::LABEL, nullptr, bodyLabel));
+    Symbol* tested = exitTest->getOp1();
+    if (condition) {
+        tested = makeTemp(condition->getRes()->getDataType());
+        tacInsertBefore(backEdge, new TAC(condition->getType(), tested, condition->getOp1(), condition->getOp2()));
+        uses[tested] = 1;
+    }
+    backEdge->setType(TACType::IFNZ);
+    backEdge->setOp1(tested);
+    backEdge->setOp2(bodyLabel);
+    return true;
+}
+
+// Loop rotation: loops test their condition at the bottom, behind a single test before the first iteration
+TAC* optimizeLoopRotation(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    // "IFZ c, L; JUMP M; LABEL L" (the end of a do while) becomes "IFNZ c, M; LABEL L"
+    int inverted = 0;
+    for (TAC* current = tacHead; current; current = current->getNext()) {
+        TAC* jump = current->getNext();
+        if (current->getType() != TACType::IFZ || !jump || jump->getType() != TACType::JUMP ||
+            !isLabelRightAfter(jump, current->getOp2())) {
+            continue;
+        }
+        current->setType(TACType::IFNZ);
+        current->setOp2(jump->getOp1());
+        tacUnlink(jump);
+        delete jump;
+        inverted++;
+    }
+
+    // Rotating a loop changes the blocks, so the CFG is rebuilt after each one
+    int rotated = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::vector<FunctionCFG> functions = buildCFG(tacHead);
+        for (FunctionCFG& cfg : functions) {
+            std::map<Symbol*, int> uses;
+            for (TAC* tac = cfg.begin; tac && tac != cfg.end; tac = tac->getNext()) {
+                for (Symbol* used : getUsedSymbols(tac)) {
+                    uses[used]++;
+                }
+            }
+
+            std::vector<std::vector<bool>> dominators = computeDominators(cfg);
+            for (const NaturalLoop& loop : findNaturalLoops(cfg, dominators)) {
+                if (rotateLoop(cfg, loop, uses)) {
+                    rotated++;
+                    changed = true;
+                    break;
+                }
+            }
+            if (changed) break;
+        }
+    }
+    int labels = removeUnusedLabels(tacHead);
+
+    std::cout << "Loop rotation completed: " << rotated << " loops rotated, " << inverted
+              << " branches inverted and " << labels << " labels removed." << std::endl;
+
+    return tacHead;
+}
+
+// Limits of the inliner: instructions of a callee body and instructions added to the whole program
+const int MAX_INLINE_SIZE = 30;
+const int MAX_INLINE_GROWTH = 2000;
+
+// Helper function to find the functions that can call themselves, directly or through other functions
+std::set<Symbol*> findRecursiveFunctions(const std::vector<FunctionCFG>& functions) {
+    std::map<Symbol*, std::set<Symbol*>> callees;
+    for (const FunctionCFG& cfg : functions) {
+        for (TAC* tac = cfg.begin; tac && tac != cfg.end; tac = tac->getNext()) {
+            if (tac->getType() == TACType::CALL) callees[cfg.function].insert(tac->getOp1());
+        }
+    }
+
+    std::set<Symbol*> recursive;
+    for (const FunctionCFG& cfg : functions) {
+        std::set<Symbol*> visited;
+        std::vector<Symbol*> pending(callees[cfg.function].begin(), callees[cfg.function].end());
+        while (!pending.empty()) {
+            Symbol* function = pending.back();
+            pending.pop_back();
+            if (function == cfg.function) {
+                recursive.insert(cfg.function);
+                break;
+            }
+            if (!visited.insert(function).second) continue;
+            pending.insert(pending.end(), callees[function].begin(), callees[function].end());
+        }
+    }
+    return recursive;
+}
+
+// Helper function to find the ARG instructions of a call, skipping the ones of calls nested in its arguments
+bool findCallArguments(TAC* call, size_t count, std::vector<TAC*>& arguments) {
+    arguments.assign(count, nullptr);
+    size_t found = 0;
+    size_t skipped = 0;
+    for (TAC* tac = call->getPrev(); tac && found < count; tac = tac->getPrev()) {
+        if (tac->getType() == TACType::BEGINFUN) return false;
+        if (tac->getType() == TACType::CALL) {
+            skipped += getFunctionParameters(tac->getOp1()).size();
+        } else if (tac->getType() == TACType::ARG) {
+            if (skipped > 0) {
+                skipped--;
+            } else {
+                arguments[count - 1 - found] = tac;
+                found++;
+            }
+        }
+    }
+    return found == count;
+}
+
+// Helper function to replace a call with a copy of the callee body, returning the first copied instruction
+// Parameters and temporaries of the copy are new temporaries and its labels are new labels;
+// each RET becomes a copy to the call result followed by a jump to the end of the copy
+TAC* inlineCall(TAC* call, const FunctionCFG& callee, const std::vector<TAC*>& arguments) {
+    std::unordered_map<Symbol*, Symbol*> renamed;
+    auto rename = [&renamed](Symbol* symbol) -> Symbol* {
+        if (!symbol) return nullptr;
+        auto it = renamed.find(symbol);
+        if (it != renamed.end()) return it->second;
+        if (symbol->getIdentifierType() == identifierType::TEMP) {
+            return renamed[symbol] = makeTemp(symbol->getDataType());
+        }
+        if (symbol->getIdentifierType() == identifierType::LABEL) {
+            return renamed[symbol] = makeLabel();
+        }
+        return symbol;
+    };
+
+    // Arguments are copied into the parameters where they were evaluated
+    std::vector<Symbol*> parameters = getFunctionParameters(callee.function);
+    for (size_t i = 0; i < parameters.size(); i++) {
+        Symbol* parameter = makeTemp(parameters[i]->getDataType());
+        renamed[parameters[i]] = parameter;
+        arguments[i]->setType(TACType::MOVE);
+        arguments[i]->setRes(parameter);
+    }
+
+    Symbol* endLabel = makeLabel();
+    TAC* first = nullptr;
+    for (TAC* tac = callee.begin->getNext(); tac && tac != callee.end; tac = tac->getNext()) {
+        if (tac->getType() == TACType::PARAM) continue;
+        if (tac->getType() == TACType::RET) {
+            TAC* result = new TAC(TACType::MOVE, call->getRes(), rename(tac->getOp1()));
+            tacInsertBefore(call, result);
+            tacInsertBefore(call, new TAC(TACType::JUMP, nullptr, endLabel));
+            if (!first) first = result;
+            continue;
+        }
+        TAC* copy = new TAC(tac->getType(), rename(tac->getRes()), rename(tac->getOp1()), rename(tac->getOp2()));
+        tacInsertBefore(call, copy);
+        if (!first) first = copy;
+    }
+
+    TAC* end = new TAC(TACType::LABEL, nullptr, endLabel);
+    tacInsertBefore(call, end);
+    tacUnlink(call);
+    delete call;
+    return first ? first : end;
+}
+
+// Inlining: replaces calls to small non recursive functions with a copy of their body
+TAC* optimizeInlining(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    std::set<Symbol*> recursive = findRecursiveFunctions(functions);
+    std::map<Symbol*, const FunctionCFG*> inlinable;
+    for (const FunctionCFG& cfg : functions) {
+        if (!cfg.end || recursive.count(cfg.function) || cfg.function->getLexeme() == "main") continue;
+
+        // Cost: every instruction of the body, returns included
+        int size = 0;
+        for (TAC* tac = cfg.begin->getNext(); tac && tac != cfg.end; tac = tac->getNext()) {
+            if (tac->getType() != TACType::PARAM) size++;
+        }
+        if (size <= MAX_INLINE_SIZE) inlinable[cfg.function] = &cfg;
+    }
+
+    // Copies may contain calls themselves; they are visited too, since they come right after
+    int inlined = 0;
+    int growth = 0;
+    Symbol* currentFunction = nullptr;
+    TAC* current = tacHead;
+    while (current) {
+        if (current->getType() == TACType::BEGINFUN) currentFunction = current->getOp1();
+
+        auto callee = current->getType() == TACType::CALL ? inlinable.find(current->getOp1()) : inlinable.end();
+        std::vector<TAC*> arguments;
+        if (callee != inlinable.end() && callee->first != currentFunction &&
+            findCallArguments(current, getFunctionParameters(callee->first).size(), arguments)) {
+            int size = 1;
+            for (TAC* tac = callee->second->begin->getNext(); tac != callee->second->end; tac = tac->getNext()) {
+                size++;
+            }
+            if (growth + size <= MAX_INLINE_GROWTH) {
+                growth += size;
+                inlined++;
+                current = inlineCall(current, *callee->second, arguments);
+                continue;
+            }
+        }
+        current = current->getNext();
+    }
+
+    std::cout << "Inlining completed: " << inlined << " calls inlined." << std::endl;
+
+    return tacHead;
+}
+
+// Tail recursion elimination: "t = CALL f; RET t" inside f becomes new parameter values and a jump to the start of f
+TAC* optimizeTailRecursion(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int eliminated = 0;
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    for (FunctionCFG& cfg : functions) {
+        if (!cfg.end) continue;
+        std::vector<Symbol*> parameters = getFunctionParameters(cfg.function);
+        Symbol* entryLabel = nullptr;
+
+        TAC* current = cfg.begin->getNext();
+        while (current && current != cfg.end) {
+            TAC* next = current->getNext();
+            std::vector<TAC*> arguments;
+            if (current->getType() != TACType::CALL || current->getOp1() != cfg.function || !next ||
+                next->getType() != TACType::RET || next->getOp1() != current->getRes() ||
+                !findCallArguments(current, parameters.size(), arguments)) {
+                current = next;
+                continue;
+            }
+
+            // The loop starts after the PARAMs, which receive the arguments of the first call only
+            if (!entryLabel) {
+                TAC* entry = cfg.begin;
+                while (entry->getNext() && entry->getNext()->getType() == TACType::PARAM) {
+                    entry = entry->getNext();
+                }
+                entryLabel = makeLabel();
+                tacInsertAfter(entry, new TAC(TACType::LABEL, nullptr, entryLabel));
+            }
+
+            // Every argument is evaluated before any parameter changes, since they may read the parameters
+            std::vector<Symbol*> values;
+            for (size_t i = 0; i < parameters.size(); i++) {
+                Symbol* value = makeTemp(parameters[i]->getDataType());
+                arguments[i]->setType(TACType::MOVE);
+                arguments[i]->setRes(value);
+                values.push_back(value);
+            }
+            for (size_t i = 0; i < parameters.size(); i++) {
+                tacInsertBefore(current, new TAC(TACType::MOVE, parameters[i], values[i]));
+            }
+            tacInsertBefore(current, new TAC(TACType::JUMP, nullptr, entryLabel));
+
+            TAC* following = next->getNext();
+            tacUnlink(current);
+            tacUnlink(next);
+            delete current;
+            delete next;
+            eliminated++;
+            current = following;
+        }
+    }
+
+    std::cout << "Tail recursion elimination completed: " << eliminated << " calls turned into jumps." << std::endl;
+
+    return tacHead;
+}
+
+// Main optimization function
+TAC* optimizeTAC(TAC* tacHead, const std::string& outputFileName) {
+    if (!tacHead) {
+        return nullptr;
+    }  
+    
+    // Copy small functions into their callers, so the other passes see through the calls
+    TAC* optimizedTac = optimizeInlining(tacHead);
+    
+    // Recursive calls whose result is returned right away become loops
+    optimizedTac = optimizeTailRecursion(optimizedTac);
+    
+    // Apply constant folding optimization
+    optimizedTac = optimizeConstantFolding(optimizedTac);
+    
+    // Reuse redundant computations inside each basic block
+    optimizedTac = optimizeLocalValueNumbering(optimizedTac);
+    
+    // Propagate copies, fold the constants they expose and propagate the folded values again
+    optimizedTac = optimizeCopyPropagation(optimizedTac);
+    optimizedTac = optimizeConstantFolding(optimizedTac);
+    optimizedTac = optimizeAlgebraicSimplification(optimizedTac);
+    optimizedTac = optimizeCopyPropagation(optimizedTac);
+    optimizedTac = optimizeConstantFolding(optimizedTac);
+    
+    // Remove the branches and blocks that the constants made useless
+    optimizedTac = optimizeControlFlow(optimizedTac);
+    
+    // Compute loop invariant values once, before the loop starts
+    optimizedTac = optimizeLoopInvariantCodeMotion(optimizedTac);
+    
+    // Drop every computation whose result is never read
+    optimizedTac = optimizeDeadCodeElimination(optimizedTac);
+    
+    // Run the iterations of simple vector loops with packed instructions
+    optimizedTac = optimizeVectorization(optimizedTac);
+    
+    // Walk vectors with pointers driven by the loop counters (after coalescing turned "t = i + 1; i = t" into "i = i + 1")
+    optimizedTac = optimizeInductionVariables(optimizedTac);
+    
+    // Dispatch on one value with a jump table or a binary search instead of a chain of equality tests
+    // (before if conversion, which would turn the last test of the chain into a select)
+    optimizedTac = optimizeEqualityChains(optimizedTac);
+    
+    // Choose between two values with a select instead of a branch (after vectorization, which matches the branches)
+    optimizedTac = optimizeIfConversion(optimizedTac);
+    
+    // Move loop tests to the bottom, once every pass that expects them at the top has run
+    optimizedTac = optimizeLoopRotation(optimizedTac);
     
     // Save optimized TAC to file
     if (!outputFileName.empty()) {
@@ -0,0 +1,264 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Peephole optimizer source code made by Nathan Alonso Guimarães (00334437)
+
+#include "peephole.hpp"
+#include <iostream>
+#include <map>
+
+// One line of the assembly file, split into mnemonic and operands when it is an instruction
+struct AsmLine {
+    std::string text;
+    bool instruction;                   // Tab-indented instruction (not a comment or a directive)
+    bool label;                         // "name:"
+    bool removed;
+    std::string mnemonic;
+    std::vector<std::string> operands;
+};
+
+// Rewrite rule applied to the window of instructions starting at one line
+struct PeepholeRule {
+    const char* name;                                   // Printed with the hit count
+    bool (*apply)(std::vector<AsmLine>& lines, int first);
+};
+
+// Helper function to split an assembly line into its parts
+AsmLine parseLine(const std::string& text) {
+    AsmLine line;
+    line.text = text;
+    line.removed = false;
+    line.instruction = text.size() > 1 && text[0] == '\t' && text[1] != '#' && text[1] != '.';
+    line.label = !text.empty() && text[0] != '\t' && text[0] != '#' && text[0] != '.' && text.back() == ':';
+    if (!line.instruction) return line;
+
+    size_t space = text.find(' ', 1);
+    line.mnemonic = text.substr(1, space == std::string::npos ? std::string::npos : space - 1);
+    if (space == std::string::npos) return line;
+
+    // Operands are separated by the commas outside of parentheses
+    std::string operand;
+    int depth = 0;
+    for (size_t i = space + 1; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '(') depth++;
+        if (c == ')') depth--;
+        if (c == ',' && depth == 0) {
+            line.operands.push_back(operand);
+            operand.clear();
+        } else if (c != ' ' || depth > 0) {
+            operand += c;
+        }
+    }
+    line.operands.push_back(operand);
+    return line;
+}
+
+// Helper function to replace an instruction, keeping its line
+void setInstruction(AsmLine& line, const std::string& mnemonic, const std::vector<std::string>& operands) {
+    std::string text = "\t" + mnemonic;
+    for (size_t i = 0; i < operands.size(); i++) {
+        text += (i == 0 ? " " : ", ") + operands[i];
+    }
+    line = parseLine(text);
+}
+
+// Helper function to find the instruction executed right after line first, skipping comments only
+// Returns -1 when a label, directive or the end of the file comes first
+int nextInstruction(const std::vector<AsmLine>& lines, int first) {
+    for (int i = first + 1; i < (int)lines.size(); i++) {
+        if (lines[i].removed) continue;
+        if (lines[i].instruction) return i;
+        const std::string& text = lines[i].text;
+        if (text.compare(0, 2, "\t#") == 0 || text.compare(0, 1, "#") == 0) continue;
+        return -1;
+    }
+    return -1;
+}
+
+// Helper function to check whether label target comes before any instruction after line first
+bool reachesLabel(const std::vector<AsmLine>& lines, int first, const std::string& target) {
+    for (int i = first + 1; i < (int)lines.size(); i++) {
+        if (lines[i].removed) continue;
+        if (lines[i].instruction) return false;
+        if (lines[i].label && lines[i].text == target + ":") return true;
+    }
+    return false;
+}
+
+bool isRegister(const std::string& operand) {
+    return !operand.empty() && operand[0] == '%';
+}
+
+bool isMemory(const std::string& operand) {
+    return !operand.empty() && operand[0] != '%' && operand[0] != '$';
+}
+
+bool isMove(const AsmLine& line) {
+    return (line.mnemonic == "movl" || line.mnemonic == "movq") && line.operands.size() == 2;
+}
+
+bool isConditionalJump(const std::string& mnemonic) {
+    static const char* jumps[] = {"je", "jne", "jl", "jle", "jg", "jge", "jb", "jbe", "ja", "jae", "js", "jns"};
+    for (const char* jump : jumps) {
+        if (mnemonic == jump) return true;
+    }
+    return false;
+}
+
+std::string getInvertedCondition(const std::string& jump) {
+    static const std::map<std::string, std::string> inverted = {
+        {"je", "jne"}, {"jne", "je"}, {"jl", "jge"}, {"jge", "jl"}, {"jg", "jle"}, {"jle", "jg"},
+        {"jb", "jae"}, {"jae", "jb"}, {"ja", "jbe"}, {"jbe", "ja"}, {"js", "jns"}, {"jns", "js"}
+    };
+    return inverted.at(jump);
+}
+
+// "movl %eax, M; movl M, %ebx" -> "movl %eax, M; movl %eax, %ebx" (the load goes away when %ebx is %eax)
+bool forwardStoredValue(std::vector<AsmLine>& lines, int first) {
+    const AsmLine& store = lines[first];
+    if (!isMove(store) || !isRegister(store.operands[0]) || !isMemory(store.operands[1])) return false;
+    int next = nextInstruction(lines, first);
+    if (next < 0) return false;
+    AsmLine& load = lines[next];
+    if (load.mnemonic != store.mnemonic || load.operands.size() != 2 || load.operands[0] != store.operands[1] ||
+        !isRegister(load.operands[1])) {
+        return false;
+    }
+    if (load.operands[1] == store.operands[0]) {
+        load.removed = true;
+    } else {
+        setInstruction(load, store.mnemonic, {store.operands[0], load.operands[1]});
+    }
+    return true;
+}
+
+// "movl %eax, %eax" -> nothing
+bool removeSelfMove(std::vector<AsmLine>& lines, int first) {
+    AsmLine& move = lines[first];
+    if (!isMove(move) || !isRegister(move.operands[0]) || move.operands[0] != move.operands[1]) return false;
+    move.removed = true;
+    return true;
+}
+
+// "movl X, M; movl Y, M" -> "movl Y, M"
+bool removeDeadStore(std::vector<AsmLine>& lines, int first) {
+    AsmLine& store = lines[first];
+    if (!isMove(store) || !isMemory(store.operands[1])) return false;
+    int next = nextInstruction(lines, first);
+    if (next < 0) return false;
+    const AsmLine& overwrite = lines[next];
+    if (overwrite.mnemonic != store.mnemonic || overwrite.operands.size() != 2 ||
+        overwrite.operands[1] != store.operands[1] || overwrite.operands[0] == store.operands[1]) {
+        return false;
+    }
+    store.removed = true;
+    return true;
+}
+
+// "addl X, %eax; cmpl $0, %eax; je L" -> "addl X, %eax; je L" (the operation already set the zero flag)
+bool removeRedundantCompare(std::vector<AsmLine>& lines, int first) {
+    static const char* flagSetters[] = {"addl", "subl", "andl", "orl", "xorl", "incl", "decl", "negl"};
+    const AsmLine& operation = lines[first];
+    bool setsFlags = false;
+    for (const char* mnemonic : flagSetters) {
+        if (operation.mnemonic == mnemonic) setsFlags = true;
+    }
+    if (!setsFlags || operation.operands.empty() || !isRegister(operation.operands.back())) return false;
+
+    int next = nextInstruction(lines, first);
+    if (next < 0) return false;
+    AsmLine& compare = lines[next];
+    const std::string& reg = operation.operands.back();
+    bool compareWithZero = (compare.mnemonic == "cmpl" && compare.operands.size() == 2 && compare.operands[0] == "$0" &&
+                            compare.operands[1] == reg) ||
+                           (compare.mnemonic == "testl" && compare.operands.size() == 2 && compare.operands[0] == reg &&
+                            compare.operands[1] == reg);
+    if (!compareWithZero) return false;
+
+    // Only the zero flag is the same: the carry and overflow flags of the operation may differ
+    int user = nextInstruction(lines, next);
+    if (user < 0) return false;
+    const std::string& mnemonic = lines[user].mnemonic;
+    if (mnemonic != "je" && mnemonic != "jne" && mnemonic != "sete" && mnemonic != "setne") return false;
+    compare.removed = true;
+    return true;
+}
+
+// "cmpl $0, %eax" -> "testl %eax, %eax"
+bool testAgainstZero(std::vector<AsmLine>& lines, int first) {
+    AsmLine& compare = lines[first];
+    if (compare.mnemonic != "cmpl" || compare.operands.size() != 2 || compare.operands[0] != "$0" ||
+        !isRegister(compare.operands[1])) {
+        return false;
+    }
+    setInstruction(compare, "testl", {compare.operands[1], compare.operands[1]});
+    return true;
+}
+
+// "jmp L; L:" -> "L:"
+bool removeJumpToNext(std::vector<AsmLine>& lines, int first) {
+    AsmLine& jump = lines[first];
+    if ((jump.mnemonic != "jmp" && !isConditionalJump(jump.mnemonic)) || jump.operands.size() != 1) return false;
+    if (!reachesLabel(lines, first, jump.operands[0])) return false;
+    jump.removed = true;
+    return true;
+}
+
+// "jl L1; jmp L2; L1:" -> "jge L2; L1:"
+bool invertBranchOverJump(std::vector<AsmLine>& lines, int first) {
+    AsmLine& branch = lines[first];
+    if (!isConditionalJump(branch.mnemonic) || branch.operands.size() != 1) return false;
+    int next = nextInstruction(lines, first);
+    if (next < 0) return false;
+    AsmLine& jump = lines[next];
+    if (jump.mnemonic != "jmp" || jump.operands.size() != 1 || !reachesLabel(lines, next, branch.operands[0])) return false;
+    setInstruction(branch, getInvertedCondition(branch.mnemonic), {jump.operands[0]});
+    jump.removed = true;
+    return true;
+}
+
+// Public interface function
+std::vector<std::string> optimizePeephole(const std::vector<std::string>& text) {
+    static const PeepholeRule rules[] = {
+        {"loads forwarded from stores", forwardStoredValue},
+        {"self moves removed", removeSelfMove},
+        {"dead stores removed", removeDeadStore},
+        {"redundant compares removed", removeRedundantCompare},
+        {"compares with zero turned into test", testAgainstZero},
+        {"jumps to the next instruction removed", removeJumpToNext},
+        {"branches over jumps inverted", invertBranchOverJump}
+    };
+    const int ruleCount = sizeof(rules) / sizeof(rules[0]);
+
+    std::vector<AsmLine> lines;
+    for (const std::string& line : text) {
+        lines.push_back(parseLine(line));
+    }
+
+    // Slide the window over the instructions until no rule applies anywhere
+    std::vector<int> hits(ruleCount, 0);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < (int)lines.size(); i++) {
+            for (int r = 0; r < ruleCount && !lines[i].removed && lines[i].instruction; r++) {
+                if (rules[r].apply(lines, i)) {
+                    hits[r]++;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> result;
+    for (const AsmLine& line : lines) {
+        if (!line.removed) result.push_back(line.text);
+    }
+
+    std::cout << "Peephole optimization completed: ";
+    for (int r = 0; r < ruleCount; r++) {
+        std::cout << hits[r] << " " << rules[r].name << (r + 1 < ruleCount ? ", " : ".");
+    }
+    std::cout << std::endl;
+
+    return result;
+}
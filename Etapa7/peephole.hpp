@@ -0,0 +1,15 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Peephole optimizer header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+#include <string>
+#include <vector>
+
+// Public interface function
+// Rewrites the lines of an assembly file (instructions, labels, directives and comments) removing
+// redundant instructions with a sliding window, and reports how many times each rule applied
+std::vector<std::string> optimizePeephole(const std::vector<std::string>& lines);
+
+#endif // PEEPHOLE_HPP
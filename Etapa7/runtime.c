@@ -0,0 +1,176 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Runtime library source code made by Nathan Alonso Guimarães (00334437)
+
+// Support functions called by the generated assembly, linked with it by the test and optimize flows.
+// Output goes to a large buffer written with write(2) when it fills up, before waiting for input and when the program exits.
+// Input is read with read(2) into another large buffer and parsed by hand.
+// Built with RUNTIME_FREESTANDING, it needs no libc: system calls are made directly and runtimeExit ends the
+// program started by the _start of the generated assembly (etapa7 --freestanding)
+
+#ifdef RUNTIME_FREESTANDING
+
+#define SYSTEM_READ 0
+#define SYSTEM_WRITE 1
+#define SYSTEM_EXIT_GROUP 231
+
+// Helper function to make a Linux x86-64 system call with up to three arguments
+static long systemCall(long number, long first, long second, long third) {
+    long result;
+    __asm__ volatile("syscall"
+                     : "=a"(result)
+                     : "a"(number), "D"(first), "S"(second), "d"(third)
+                     : "rcx", "r11", "memory");
+    return result;
+}
+
+static long writeOutput(const char* data, long length) {
+    return systemCall(SYSTEM_WRITE, 1, (long)data, length);
+}
+
+static long readInput(char* data, long length) {
+    return systemCall(SYSTEM_READ, 0, (long)data, length);
+}
+
+#else
+
+#include <unistd.h>
+
+static long writeOutput(const char* data, long length) {
+    return (long)write(1, data, (size_t)length);
+}
+
+static long readInput(char* data, long length) {
+    return (long)read(0, data, (size_t)length);
+}
+
+#endif
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define INPUT_BUFFER_SIZE (1 << 16)
+
+static char outputBuffer[OUTPUT_BUFFER_SIZE];
+static int outputLength = 0;
+
+static char inputBuffer[INPUT_BUFFER_SIZE];
+static int inputPosition = 0;
+static int inputLength = 0;
+static int inputFinished = 0;
+
+// Pairs of decimal digits "00" to "99", so each division by 100 writes two digits at once
+static const char digitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void runtimeFlush(void) {
+    int written = 0;
+    while (written < outputLength) {
+        long result = writeOutput(outputBuffer + written, outputLength - written);
+        if (result <= 0) break;
+        written += (int)result;
+    }
+    outputLength = 0;
+}
+
+#ifdef RUNTIME_FREESTANDING
+
+// Called by _start with the value main returned
+void runtimeExit(int status) {
+    runtimeFlush();
+    systemCall(SYSTEM_EXIT_GROUP, status, 0, 0);
+    for (;;) {
+    }
+}
+
+#else
+
+// Flushes whatever is left once main returns
+__attribute__((destructor)) static void runtimeFinish(void) {
+    runtimeFlush();
+}
+
+#endif
+
+void runtimePrintInt(int value) {
+    // Sign, 10 digits
+    if (outputLength > OUTPUT_BUFFER_SIZE - 11) runtimeFlush();
+
+    unsigned int magnitude = (unsigned int)value;
+    if (value < 0) {
+        outputBuffer[outputLength++] = '-';
+        magnitude = 0u - magnitude;
+    }
+
+    // Digits are produced from the end of a small scratch buffer, then copied
+    char digits[10];
+    int position = 10;
+    while (magnitude >= 100) {
+        unsigned int pair = (magnitude % 100) * 2;
+        magnitude /= 100;
+        digits[--position] = digitPairs[pair + 1];
+        digits[--position] = digitPairs[pair];
+    }
+    if (magnitude >= 10) {
+        digits[--position] = digitPairs[magnitude * 2 + 1];
+        digits[--position] = digitPairs[magnitude * 2];
+    } else {
+        digits[--position] = (char)('0' + magnitude);
+    }
+    while (position < 10) {
+        outputBuffer[outputLength++] = digits[position++];
+    }
+}
+
+void runtimePrintString(const char* text) {
+    while (*text) {
+        if (outputLength == OUTPUT_BUFFER_SIZE) runtimeFlush();
+        outputBuffer[outputLength++] = *text++;
+    }
+}
+
+// Helper function to get the next input character without consuming it, or -1 at the end of the input
+static int peekInput(void) {
+    if (inputPosition < inputLength) return (unsigned char)inputBuffer[inputPosition];
+    if (inputFinished) return -1;
+
+    // The program is about to wait for input: show what it printed so far (prompts)
+    runtimeFlush();
+    long result = readInput(inputBuffer, INPUT_BUFFER_SIZE);
+    if (result <= 0) {
+        inputFinished = 1;
+        return -1;
+    }
+    inputPosition = 0;
+    inputLength = (int)result;
+    return (unsigned char)inputBuffer[0];
+}
+
+// Reads the next signed decimal integer, skipping the whitespace before it
+// Returns 0 at the end of the input or when the next character can not start a number (which is consumed),
+// and wraps around like int arithmetic when the number does not fit
+int runtimeReadInt(void) {
+    int c = peekInput();
+    while (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+        inputPosition++;
+        c = peekInput();
+    }
+
+    int negative = 0;
+    if (c == '-' || c == '+') {
+        negative = c == '-';
+        inputPosition++;
+        c = peekInput();
+    }
+    if (c < '0' || c > '9') {
+        if (c >= 0) inputPosition++;
+        return 0;
+    }
+
+    unsigned int value = 0;
+    while (c >= '0' && c <= '9') {
+        value = value * 10u + (unsigned int)(c - '0');
+        inputPosition++;
+        c = peekInput();
+    }
+    return (int)(negative ? 0u - value : value);
+}
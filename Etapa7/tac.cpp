@@ -7,19 +7,19 @@
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <map>
 
 TAC* tacCreate(TACType type, Symbol* res = nullptr, Symbol* op1 = nullptr, Symbol* op2 = nullptr);
 TAC* tacJoin(TAC* tac1, TAC* tac2);
 TAC* tacReverse(TAC* tac);
 void tacPrintBackwards(TAC* tac);
-Symbol* makeTemp(dataType type);
-Symbol* makeLabel();
 Symbol* getResultSymbol(TAC* tacSequence, ASTNode* node);
 std::string truncateString(const std::string& str, size_t maxWidth);
 std::string tacTypeToString(TACType type);
 
 TAC* generateBinaryOp(ASTNode* node);
 TAC* generateUnaryOp(ASTNode* node);
+TAC* generateCondition(ASTNode* node, Symbol* label, bool jumpIfTrue);
 TAC* generateAssignment(ASTNode* node);
 TAC* generateVariableDeclaration(ASTNode* node);
 TAC* generateVectorDeclaration(ASTNode* node);
@@ -37,6 +37,7 @@ TAC* generateVectorAssignment(ASTNode* node);
 
 static int tempCounter = 0;
 static int labelCounter = 0;
+static std::map<Symbol*, std::vector<Symbol*>> functionParameters; // Function symbol to its parameters, in order
 
 TAC::TAC(TACType type, Symbol* res, Symbol* op1, Symbol* op2) 
     : type(type), result(res), operand1(op1), operand2(op2), previous(nullptr), next(nullptr) {
@@ -77,6 +78,14 @@ void TAC::setNext(TAC* next) {
     this->next = next;
 }
 
+void TAC::setType(TACType type) {
+    this->type = type;
+}
+
+void TAC::setRes(Symbol* res) {
+    this->result = res;
+}
+
 void TAC::setOp1(Symbol* op1) {
     this->operand1 = op1;
 }
@@ -162,6 +171,41 @@ TAC* tacReverse(TAC* tac) {
     return newHead;
 }
 
+void tacInsertBefore(TAC* position, TAC* tac) {
+    if (!position || !tac) return;
+    
+    tac->setPrev(position->getPrev());
+    tac->setNext(position);
+    if (position->getPrev()) {
+        position->getPrev()->setNext(tac);
+    }
+    position->setPrev(tac);
+}
+
+void tacInsertAfter(TAC* position, TAC* tac) {
+    if (!position || !tac) return;
+    
+    tac->setNext(position->getNext());
+    tac->setPrev(position);
+    if (position->getNext()) {
+        position->getNext()->setPrev(tac);
+    }
+    position->setNext(tac);
+}
+
+void tacUnlink(TAC* tac) {
+    if (!tac) return;
+    
+    if (tac->getPrev()) {
+        tac->getPrev()->setNext(tac->getNext());
+    }
+    if (tac->getNext()) {
+        tac->getNext()->setPrev(tac->getPrev());
+    }
+    tac->setPrev(nullptr);
+    tac->setNext(nullptr);
+}
+
 void printTAC(TAC* tac) {
     if (!tac) return;
 
@@ -324,7 +368,7 @@ Symbol* getResultSymbol(TAC* tacSequence, ASTNode* node) {
 }
 
 // Symbol creation functions
-Symbol* makeTemp(dataType type = dataType::INT) {
+Symbol* makeTemp(dataType type) {
     std::stringstream ss;
     ss << "__temp" << tempCounter++;
     Symbol* temp = insertSymbol(ss.str(), INTERNAL, 1); // Using INTERNAL type and line number 1 as default
@@ -584,6 +628,78 @@ TAC* generateUnaryOp(ASTNode* node) {
     return tacJoin(operandCode, opTac);
 }
 
+// Helper function to get the comparison that is true exactly when the given one is false
+TACType getNegatedComparison(TACType type) {
+    switch (type) {
+        case TACType::LT: return TACType::GE;
+        case TACType::GT: return TACType::LE;
+        case TACType::LE: return TACType::GT;
+        case TACType::GE: return TACType::LT;
+        case TACType::EQ: return TACType::NE;
+        default: return TACType::EQ;
+    }
+}
+
+// Condition of an if or loop: jumps to label when the condition is false (or true, if jumpIfTrue)
+// and falls through otherwise. The right side of & and | is only evaluated when it decides the result
+TAC* generateCondition(ASTNode* node, Symbol* label, bool jumpIfTrue) {
+    if (!node) return nullptr;
+
+    switch (node->getType()) {
+        case ASTNodeType::AND:
+        case ASTNodeType::OR: {
+            if (node->getChildren().size() < 2) break;
+            ASTNode* left = node->getChildren()[0];
+            ASTNode* right = node->getChildren()[1];
+
+            // a & b jumps on false if either side is false, a | b jumps on true if either side is true
+            bool isAnd = node->getType() == ASTNodeType::AND;
+            if (isAnd != jumpIfTrue) {
+                return tacJoin(generateCondition(left, label, jumpIfTrue),
+                               generateCondition(right, label, jumpIfTrue));
+            }
+
+            // Otherwise the left side alone can only skip the jump
+            Symbol* skipLabel = makeLabel();
+            TAC* result = generateCondition(left, skipLabel, !jumpIfTrue);
+            result = tacJoin(result, generateCondition(right, label, jumpIfTrue));
+            return tacJoin(result, tacCreate(TACType::LABEL, nullptr, skipLabel, nullptr));
+        }
+        case ASTNodeType::NOT:
+            if (node->getChildren().empty()) break;
+            return generateCondition(node->getChildren()[0], label, !jumpIfTrue);
+        case ASTNodeType::LESS_THAN:
+        case ASTNodeType::GREATER_THAN:
+        case ASTNodeType::LESS_EQUAL:
+        case ASTNodeType::GREATER_EQUAL:
+        case ASTNodeType::EQUAL:
+        case ASTNodeType::DIFFERENT: {
+            if (!jumpIfTrue) break;
+
+            // IFZ jumps when its operand is zero, so jumping on true tests the negated comparison
+            TAC* comparisonCode = generateBinaryOp(node);
+            if (!comparisonCode) return nullptr;
+            TAC* comparison = comparisonCode;
+            while (comparison->getNext()) {
+                comparison = comparison->getNext();
+            }
+            comparison->setType(getNegatedComparison(comparison->getType()));
+            return tacJoin(comparisonCode, tacCreate(TACType::IFZ, nullptr, comparison->getRes(), label));
+        }
+        default:
+            break;
+    }
+
+    TAC* valueCode = generateTAC(node);
+    Symbol* valueSymbol = getResultSymbol(valueCode, node);
+    if (jumpIfTrue) {
+        Symbol* temp = makeTemp(inferComparisonDataType(valueSymbol));
+        valueCode = tacJoin(valueCode, tacCreate(TACType::NOT, temp, valueSymbol, nullptr));
+        valueSymbol = temp;
+    }
+    return tacJoin(valueCode, tacCreate(TACType::IFZ, nullptr, valueSymbol, label));
+}
+
 TAC* generateAssignment(ASTNode* node) {
     if (node->getChildren().size() < 2) return nullptr;
     
@@ -604,7 +720,10 @@ TAC* generateAssignment(ASTNode* node) {
 TAC* generateIf(ASTNode* node) {
     if (node->getChildren().size() < 2) return nullptr;
     
-    TAC* conditionCode = generateTAC(node->getChildren()[0]);
+    Symbol* elseLabel = makeLabel();
+    Symbol* endLabel = makeLabel();
+    
+    TAC* conditionCode = generateCondition(node->getChildren()[0], elseLabel, false);
     TAC* thenCode = generateTAC(node->getChildren()[1]);
     TAC* elseCode = nullptr;
     
@@ -612,17 +731,10 @@ TAC* generateIf(ASTNode* node) {
         elseCode = generateTAC(node->getChildren()[2]);
     }
     
-    Symbol* conditionSymbol = getResultSymbol(conditionCode, node->getChildren()[0]);
-    
-    Symbol* elseLabel = makeLabel();
-    Symbol* endLabel = makeLabel();
-    
-    TAC* ifzTac = tacCreate(TACType::IFZ, nullptr, conditionSymbol, elseLabel);
     TAC* elseLabelTac = tacCreate(TACType::LABEL, nullptr, elseLabel, nullptr);
     TAC* endLabelTac = tacCreate(TACType::LABEL, nullptr, endLabel, nullptr);
     
-    TAC* result = tacJoin(conditionCode, ifzTac);
-    result = tacJoin(result, thenCode);
+    TAC* result = tacJoin(conditionCode, thenCode);
     
     if (elseCode) {
         TAC* jumpTac = tacCreate(TACType::JUMP, nullptr, endLabel, nullptr);
@@ -644,17 +756,13 @@ TAC* generateWhile(ASTNode* node) {
     Symbol* endLabel = makeLabel();
     
     TAC* beginLabelTac = tacCreate(TACType::LABEL, nullptr, beginLabel, nullptr);
-    TAC* conditionCode = generateTAC(node->getChildren()[0]);
+    TAC* conditionCode = generateCondition(node->getChildren()[0], endLabel, false);
     TAC* bodyCode = generateTAC(node->getChildren()[1]);
     
-    Symbol* conditionSymbol = getResultSymbol(conditionCode, node->getChildren()[0]);
-    
-    TAC* ifzTac = tacCreate(TACType::IFZ, nullptr, conditionSymbol, endLabel);
     TAC* jumpTac = tacCreate(TACType::JUMP, nullptr, beginLabel, nullptr);
     TAC* endLabelTac = tacCreate(TACType::LABEL, nullptr, endLabel, nullptr);
     
     TAC* result = tacJoin(beginLabelTac, conditionCode);
-    result = tacJoin(result, ifzTac);
     result = tacJoin(result, bodyCode);
     result = tacJoin(result, jumpTac);
     result = tacJoin(result, endLabelTac);
@@ -744,6 +852,25 @@ TAC* generateFunctionCall(ASTNode* node) {
     return result;
 }
 
+// Helper function to collect the parameter symbols of a PARAMETERS_LIST chain, in declaration order
+void collectParameterSymbols(ASTNode* node, std::vector<Symbol*>& parameters) {
+    if (!node) return;
+    
+    for (ASTNode* child : node->getChildren()) {
+        if (!child) continue;
+        if (child->getType() == ASTNodeType::SYMBOL && child->getSymbol()) {
+            parameters.push_back(child->getSymbol());
+        } else if (child->getType() == ASTNodeType::PARAMETERS_LIST || child->getType() == ASTNodeType::FORMAL_PARAMETERS) {
+            collectParameterSymbols(child, parameters);
+        }
+    }
+}
+
+std::vector<Symbol*> getFunctionParameters(Symbol* function) {
+    auto it = functionParameters.find(function);
+    return it != functionParameters.end() ? it->second : std::vector<Symbol*>();
+}
+
 TAC* generateFunctionDeclaration(ASTNode* node) {
     if (node->getChildren().empty()) return nullptr;
     
@@ -758,7 +885,19 @@ TAC* generateFunctionDeclaration(ASTNode* node) {
         }
     }
     
+    // Parameters are listed with PARAM right after BEGINFUN
+    std::vector<Symbol*> parameters;
+    for (ASTNode* child : node->getChildren()) {
+        if (child && child->getType() == ASTNodeType::FORMAL_PARAMETERS) {
+            collectParameterSymbols(child, parameters);
+        }
+    }
+    functionParameters[functionSymbol] = parameters;
+    
     TAC* beginTac = tacCreate(TACType::BEGINFUN, nullptr, functionSymbol, nullptr);
+    for (Symbol* parameter : parameters) {
+        beginTac = tacJoin(beginTac, tacCreate(TACType::PARAM, parameter, nullptr, nullptr));
+    }
     
     TAC* bodyCode = nullptr;
     for (size_t i = 1; i < node->getChildren().size(); i++) {
@@ -1138,19 +1277,15 @@ TAC* generateDoWhile(ASTNode* node) {
     
     TAC* beginLabelTac = tacCreate(TACType::LABEL, nullptr, beginLabel, nullptr);
     TAC* bodyCode = generateTAC(node->getChildren()[0]); // body comes first in do-while
-    TAC* conditionCode = generateTAC(node->getChildren()[1]); // condition comes second
-    
-    Symbol* conditionSymbol = getResultSymbol(conditionCode, node->getChildren()[1]);
     
     // For do-while: jump back to beginning if condition is true (non-zero)
     // IFZ jumps if the condition is zero (false), so we jump to end when condition is false
-    TAC* ifzTac = tacCreate(TACType::IFZ, nullptr, conditionSymbol, endLabel);
+    TAC* conditionCode = generateCondition(node->getChildren()[1], endLabel, false); // condition comes second
     TAC* jumpTac = tacCreate(TACType::JUMP, nullptr, beginLabel, nullptr);
     TAC* endLabelTac = tacCreate(TACType::LABEL, nullptr, endLabel, nullptr);
     
     TAC* result = tacJoin(beginLabelTac, bodyCode);
     result = tacJoin(result, conditionCode);
-    result = tacJoin(result, ifzTac);
     result = tacJoin(result, jumpTac);
     result = tacJoin(result, endLabelTac);
     
@@ -1163,6 +1298,7 @@ std::string tacTypeToString(TACType type) {
     switch (type) {
         case TACType::SYMBOL: return "SYMBOL";
         case TACType::MOVE: return "MOVE";
+        case TACType::SELECT: return "SELECT";
         case TACType::INIT: return "INIT";
         case TACType::ADD: return "ADD";
         case TACType::SUB: return "SUB";
@@ -1182,9 +1318,12 @@ std::string tacTypeToString(TACType type) {
         case TACType::BEGINFUN: return "BEGINFUN";
         case TACType::ENDFUN: return "ENDFUN";
         case TACType::IFZ: return "IFZ";
+        case TACType::IFNZ: return "IFNZ";
         case TACType::JUMP: return "JUMP";
+        case TACType::JUMPTABLE: return "JUMPTABLE";
         case TACType::CALL: return "CALL";
         case TACType::ARG: return "ARG";
+        case TACType::PARAM: return "PARAM";
         case TACType::RET: return "RET";
         case TACType::PRINT: return "PRINT";
         case TACType::READ: return "READ";
@@ -1192,6 +1331,11 @@ std::string tacTypeToString(TACType type) {
         case TACType::VECREAD: return "VECREAD";
         case TACType::BEGINVEC: return "BEGINVEC";
         case TACType::ENDVEC: return "ENDVEC";
+        case TACType::VECADDR: return "VECADDR";
+        case TACType::PTRREAD: return "PTRREAD";
+        case TACType::PTRWRITE: return "PTRWRITE";
+        case TACType::PTRADD: return "PTRADD";
+        case TACType::VECLOOP: return "VECLOOP";
         default: return "UNKNOWN";
     }
 }
@@ -1199,4 +1343,5 @@ std::string tacTypeToString(TACType type) {
 void initTAC() {
     tempCounter = 0;
     labelCounter = 0;
+    functionParameters.clear();
 }
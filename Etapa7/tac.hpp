@@ -6,12 +6,14 @@
 #include "symbol.hpp"
 #include "ast.hpp"
 #include <string>
+#include <vector>
 
 // TAC operation types
 enum class TACType {
     SYMBOL,     // Symbol reference (utility)
                 // Using res = a, op1 = b, op2 = c
     MOVE,       // Assignment: a = b
+    SELECT,     // Conditional assignment: a = b if c != 0 (a keeps its value otherwise)
     INIT,       // Variable initialization: a = b (first assignment)
     ADD,        // Addition: a = b + c
     SUB,        // Subtraction: a = b - c
@@ -31,16 +33,24 @@ enum class TACType {
     BEGINFUN,   // Begin function definition
     ENDFUN,     // End function definition
     IFZ,        // Conditional jump if zero: if (a == 0) goto label
+    IFNZ,       // Conditional jump if not zero: if (a != 0) goto label
     JUMP,       // Unconditional jump: goto label
+    JUMPTABLE,  // Indexed jump: goto the case label of a, or to label b when a has none (table kept by the lowering)
     CALL,       // Function call: a = call f
     ARG,        // Function argument: arg a
+    PARAM,      // Formal parameter: a receives the next argument (right after BEGINFUN, in order)
     RET,        // Return: return a
     PRINT,      // Print: print a
     READ,       // Read: read a
     VECWRITE,   // Vector write: a[b] = c
     VECREAD,    // Vector read: a = b[c]
     BEGINVEC,   // Begin vector initialization
-    ENDVEC      // End vector initialization
+    ENDVEC,     // End vector initialization
+    VECADDR,    // Vector element address: a = &b[c]
+    PTRREAD,    // Read through pointer: a = *b
+    PTRWRITE,   // Write through pointer: *a = b
+    PTRADD,     // Pointer advance: a = b + c elements
+    VECLOOP     // Packed iterations of a vectorized loop: while (a < b) (kernel kept by the vectorizer)
 };
 
 // TAC instruction structure
@@ -68,6 +78,8 @@ public:
     // Setters
     void setPrev(TAC* prev);
     void setNext(TAC* next);
+    void setType(TACType type);
+    void setRes(Symbol* res);
     void setOp1(Symbol* op1);
     void setOp2(Symbol* op2);
     
@@ -79,4 +91,10 @@ public:
 TAC* generateTAC(ASTNode* node);
 void printTAC(TAC* tac);
 void printTACToFile(const std::string& filename, TAC* tac);
+void tacInsertBefore(TAC* position, TAC* tac);      // Link tac right before position
+void tacInsertAfter(TAC* position, TAC* tac);       // Link tac right after position
+void tacUnlink(TAC* tac);                           // Unlink tac from its list (does not delete it)
+Symbol* makeTemp(dataType type = dataType::INT);    // Create a new temporary symbol
+Symbol* makeLabel();                                // Create a new label symbol
+std::vector<Symbol*> getFunctionParameters(Symbol* function); // Parameters of a function, in declaration order
 void initTAC();
\ No newline at end of file
@@ -0,0 +1,441 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Loop vectorizer implementation file made by Nathan Alonso Guimarães (00334437)
+
+#include "vectorizer.hpp"
+#include "tac.hpp"
+#include "cfg.hpp"
+#include "symbol.hpp"
+#include "parser.tab.hpp"
+#include <iostream>
+#include <map>
+#include <set>
+
+// Kernels of the VECLOOP instructions created by the vectorizer
+static std::map<TAC*, VectorKernel> kernels;
+
+// Limits of the backend: general purpose registers for vector bases and vector registers for nodes
+static const size_t MAX_KERNEL_VECTORS = 6;
+static const size_t MAX_KERNEL_REGISTERS = 13;
+
+const VectorKernel* getVectorKernel(TAC* tac) {
+    auto it = kernels.find(tac);
+    return it != kernels.end() ? &it->second : nullptr;
+}
+
+std::vector<Symbol*> getVectorKernelOperands(TAC* tac) {
+    std::vector<Symbol*> operands;
+    const VectorKernel* kernel = getVectorKernel(tac);
+    if (!kernel) return operands;
+
+    operands.push_back(kernel->index);
+    operands.push_back(kernel->limit);
+    for (const LaneNode& node : kernel->nodes) {
+        if (node.symbol) operands.push_back(node.symbol);
+    }
+    for (const auto& store : kernel->stores) {
+        operands.push_back(store.first);
+    }
+    for (const VectorReduction& reduction : kernel->reductions) {
+        operands.push_back(reduction.accumulator);
+    }
+
+    std::vector<Symbol*> variables;
+    for (Symbol* symbol : operands) {
+        if (isVariableSymbol(symbol)) variables.push_back(symbol);
+    }
+    return variables;
+}
+
+// Helper function to check if a symbol is an integer or character literal
+static bool isIntegerLiteral(Symbol* symbol) {
+    return symbol && !isVariableSymbol(symbol) &&
+           (symbol->getType() == LIT_INT || symbol->getType() == LIT_CHAR);
+}
+
+// Builds the lane expression graph of a loop body, rejecting anything that is not element-wise
+class KernelBuilder {
+public:
+    KernelBuilder(VectorKernel& kernel, const std::map<Symbol*, int>& loopDefinitions)
+        : kernel(kernel), loopDefinitions(loopDefinitions), regionCondition(-1), regionLabel(nullptr) {}
+
+    bool addInstruction(TAC* tac);
+    bool finish(const std::vector<TAC*>& body);
+
+private:
+    VectorKernel& kernel;
+    const std::map<Symbol*, int>& loopDefinitions;
+    std::map<Symbol*, int> values;              // Temporaries to the node holding their value
+    std::map<Symbol*, int> loads;               // Vector to its LOAD node
+    std::map<Symbol*, int> broadcasts;          // Scalar to its BROADCAST node
+    std::map<Symbol*, int> accumulatorNodes;    // Accumulator to its ACCUMULATOR node
+    std::map<Symbol*, int> lastStores;          // Vector to the node last stored at index
+    int regionCondition;                        // Node guarding the current "if" body, -1 outside of it
+    Symbol* regionLabel;                        // Label that ends the current "if" body
+    std::set<Symbol*> regionTemps;              // Temporaries defined inside the current "if" body
+
+    int addNode(LaneOperation operation, Symbol* symbol, int left, int right, bool inverted = false) {
+        LaneNode node = {operation, symbol, left, right, inverted};
+        kernel.nodes.push_back(node);
+        return static_cast<int>(kernel.nodes.size()) - 1;
+    }
+
+    bool isAccumulatorCandidate(Symbol* symbol) const {
+        return symbol && symbol != kernel.index && symbol->getIdentifierType() == identifierType::VARIABLE &&
+               loopDefinitions.count(symbol);
+    }
+
+    int operand(Symbol* symbol);
+    int load(Symbol* vector);
+    bool define(Symbol* temp, int node);
+    bool addReduction(Symbol* accumulator, ReductionKind kind, int node);
+    bool addConditionalAssignment(Symbol* accumulator, int value);
+};
+
+int KernelBuilder::operand(Symbol* symbol) {
+    if (!symbol || symbol == kernel.index) return -1;
+
+    auto value = values.find(symbol);
+    if (value != values.end()) return value->second;
+
+    if (isAccumulatorCandidate(symbol)) {
+        auto it = accumulatorNodes.find(symbol);
+        if (it != accumulatorNodes.end()) return it->second;
+        int node = addNode(LaneOperation::ACCUMULATOR, symbol, -1, -1);
+        accumulatorNodes[symbol] = node;
+        return node;
+    }
+
+    // Anything else defined in the loop is carried from a previous iteration or only conditionally defined
+    if (loopDefinitions.count(symbol)) return -1;
+    if (isVariableSymbol(symbol) && symbol->getIdentifierType() == identifierType::VECTOR) return -1;
+    if (!isVariableSymbol(symbol) && !isIntegerLiteral(symbol)) return -1;
+
+    auto it = broadcasts.find(symbol);
+    if (it != broadcasts.end()) return it->second;
+    int node = addNode(LaneOperation::BROADCAST, symbol, -1, -1);
+    broadcasts[symbol] = node;
+    return node;
+}
+
+int KernelBuilder::load(Symbol* vector) {
+    // A read after a write of the same element sees the written value
+    auto stored = lastStores.find(vector);
+    if (stored != lastStores.end()) return stored->second;
+
+    auto it = loads.find(vector);
+    if (it != loads.end()) return it->second;
+    int node = addNode(LaneOperation::LOAD, vector, -1, -1);
+    loads[vector] = node;
+    return node;
+}
+
+bool KernelBuilder::define(Symbol* temp, int node) {
+    if (node < 0) return false;
+
+    if (regionCondition >= 0) {
+        // A value overwritten only when the condition holds would need a blend
+        if (values.count(temp) && !regionTemps.count(temp)) return false;
+        regionTemps.insert(temp);
+    }
+    values[temp] = node;
+    return true;
+}
+
+bool KernelBuilder::addReduction(Symbol* accumulator, ReductionKind kind, int node) {
+    if (node < 0) return false;
+    for (const VectorReduction& reduction : kernel.reductions) {
+        if (reduction.accumulator == accumulator) return false;
+    }
+
+    // Inside an "if" body only the lanes where the condition holds contribute
+    if (regionCondition >= 0) {
+        node = addNode(LaneOperation::SELECT, nullptr, regionCondition, node);
+    }
+    VectorReduction reduction = {accumulator, kind, node};
+    kernel.reductions.push_back(reduction);
+    return true;
+}
+
+// "if (value > m) m = value" and the other comparison forms become max or min reductions
+bool KernelBuilder::addConditionalAssignment(Symbol* accumulator, int value) {
+    if (regionCondition < 0 || value < 0) return false;
+
+    auto it = accumulatorNodes.find(accumulator);
+    if (it == accumulatorNodes.end()) return false;
+    int running = it->second;
+
+    const LaneNode& condition = kernel.nodes[regionCondition];
+    if (condition.operation != LaneOperation::GT) return false;
+
+    bool valueIsGreater;
+    if (condition.left == value && condition.right == running) {
+        valueIsGreater = !condition.inverted;
+    } else if (condition.left == running && condition.right == value) {
+        valueIsGreater = condition.inverted;
+    } else {
+        return false;
+    }
+
+    for (const VectorReduction& reduction : kernel.reductions) {
+        if (reduction.accumulator == accumulator) return false;
+    }
+    VectorReduction reduction = {accumulator, valueIsGreater ? ReductionKind::MAX : ReductionKind::MIN, value};
+    kernel.reductions.push_back(reduction);
+    return true;
+}
+
+bool KernelBuilder::addInstruction(TAC* tac) {
+    Symbol* res = tac->getRes();
+    Symbol* op1 = tac->getOp1();
+    Symbol* op2 = tac->getOp2();
+    bool tempResult = res && res->getIdentifierType() == identifierType::TEMP;
+
+    // Reductions: "s = s + x", "s = x + s" and "s = s - x"
+    if ((tac->getType() == TACType::ADD || tac->getType() == TACType::SUB) && isAccumulatorCandidate(res)) {
+        if (op1 == res && op2 != res) {
+            ReductionKind kind = tac->getType() == TACType::ADD ? ReductionKind::SUM : ReductionKind::DIFFERENCE;
+            return addReduction(res, kind, operand(op2));
+        }
+        if (tac->getType() == TACType::ADD && op2 == res && op1 != res) {
+            return addReduction(res, ReductionKind::SUM, operand(op1));
+        }
+        return false;
+    }
+
+    switch (tac->getType()) {
+        case TACType::LABEL:
+            if (op1 != regionLabel) return false;
+            for (Symbol* temp : regionTemps) {
+                values.erase(temp);
+            }
+            regionTemps.clear();
+            regionCondition = -1;
+            regionLabel = nullptr;
+            return true;
+
+        case TACType::IFZ: {
+            if (regionCondition >= 0) return false;
+            auto condition = values.find(op1);
+            if (condition == values.end()) return false;
+            regionCondition = condition->second;
+            regionLabel = op2;
+            return true;
+        }
+
+        case TACType::VECREAD:
+            if (op2 != kernel.index) return false;
+            if (tempResult) return define(res, load(op1));
+            if (isAccumulatorCandidate(res)) return addConditionalAssignment(res, load(op1));
+            return false;
+
+        case TACType::VECWRITE: {
+            if (op1 != kernel.index || regionCondition >= 0) return false;
+            int value = operand(op2);
+            if (value < 0 || kernel.nodes[value].operation == LaneOperation::ACCUMULATOR) return false;
+            kernel.stores.push_back(std::make_pair(res, value));
+            lastStores[res] = value;
+            return true;
+        }
+
+        case TACType::MOVE:
+            if (tempResult) return define(res, operand(op1));
+            if (isAccumulatorCandidate(res)) return addConditionalAssignment(res, operand(op1));
+            return false;
+
+        case TACType::ADD:
+        case TACType::SUB:
+        case TACType::MUL:
+        case TACType::LT:
+        case TACType::GT:
+        case TACType::LE:
+        case TACType::GE:
+        case TACType::EQ:
+        case TACType::NE: {
+            if (!tempResult) return false;
+            int left = operand(op1);
+            int right = operand(op2);
+            if (left < 0 || right < 0) return false;
+
+            switch (tac->getType()) {
+                case TACType::ADD: return define(res, addNode(LaneOperation::ADD, nullptr, left, right));
+                case TACType::SUB: return define(res, addNode(LaneOperation::SUB, nullptr, left, right));
+                case TACType::MUL: return define(res, addNode(LaneOperation::MUL, nullptr, left, right));
+                case TACType::GT: return define(res, addNode(LaneOperation::GT, nullptr, left, right));
+                case TACType::LT: return define(res, addNode(LaneOperation::GT, nullptr, right, left));
+                case TACType::LE: return define(res, addNode(LaneOperation::GT, nullptr, left, right, true));
+                case TACType::GE: return define(res, addNode(LaneOperation::GT, nullptr, right, left, true));
+                case TACType::EQ: return define(res, addNode(LaneOperation::EQ, nullptr, left, right));
+                default: return define(res, addNode(LaneOperation::EQ, nullptr, left, right, true));
+            }
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool KernelBuilder::finish(const std::vector<TAC*>& body) {
+    if (regionCondition >= 0) return false;
+    if (kernel.stores.empty() && kernel.reductions.empty()) return false;
+
+    // Every accumulator is only read by its own reduction (or by the comparison of a max/min)
+    std::map<Symbol*, int> uses;
+    for (TAC* tac : body) {
+        for (Symbol* used : getUsedSymbols(tac)) {
+            uses[used]++;
+        }
+    }
+    for (const auto& definition : loopDefinitions) {
+        Symbol* symbol = definition.first;
+        if (!isAccumulatorCandidate(symbol)) continue;
+        bool reduced = false;
+        for (const VectorReduction& reduction : kernel.reductions) {
+            if (reduction.accumulator == symbol) reduced = true;
+        }
+        if (!reduced || definition.second != 1 || uses[symbol] != 1) return false;
+    }
+
+    // Only the nodes that reach a store or a reduction are computed, and none of them may need an accumulator
+    std::vector<bool> needed(kernel.nodes.size(), false);
+    for (const auto& store : kernel.stores) needed[store.second] = true;
+    for (const VectorReduction& reduction : kernel.reductions) needed[reduction.node] = true;
+    for (size_t i = kernel.nodes.size(); i-- > 0;) {
+        if (!needed[i]) continue;
+        const LaneNode& node = kernel.nodes[i];
+        if (node.operation == LaneOperation::ACCUMULATOR) return false;
+        if (node.left >= 0) needed[node.left] = true;
+        if (node.right >= 0) needed[node.right] = true;
+    }
+
+    size_t registers = kernel.reductions.size();
+    std::set<Symbol*> vectors;
+    for (size_t i = 0; i < kernel.nodes.size(); i++) {
+        if (!needed[i]) continue;
+        registers++;
+        if (kernel.nodes[i].operation == LaneOperation::LOAD) vectors.insert(kernel.nodes[i].symbol);
+    }
+    for (const auto& store : kernel.stores) vectors.insert(store.first);
+
+    return vectors.size() <= MAX_KERNEL_VECTORS && registers <= MAX_KERNEL_REGISTERS;
+}
+
+// Helper function to check if every store of a kernel is a fill (invariant value) or a copy (element of a vector)
+// Stores must go to different vectors and no copy may read a vector that another store writes,
+// so running them one after the other over the whole range gives the same result as the loop
+static bool isBulkKernel(const VectorKernel& kernel) {
+    if (kernel.stores.empty() || !kernel.reductions.empty()) return false;
+
+    std::set<Symbol*> written;
+    for (const auto& store : kernel.stores) {
+        if (!written.insert(store.first).second) return false;
+    }
+    for (const auto& store : kernel.stores) {
+        const LaneNode& node = kernel.nodes[store.second];
+        if (node.operation == LaneOperation::LOAD) {
+            if (node.symbol != store.first && written.count(node.symbol)) return false;
+        } else if (node.operation != LaneOperation::BROADCAST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Helper function to check the shape of a loop and build its kernel
+// The loop must be laid out as: LABEL h; c = i < n; IFZ c, exit; body; i = i + 1; JUMP h
+static bool analyzeLoop(const FunctionCFG& cfg, const NaturalLoop& loop, const Liveness& liveness, VectorKernel& kernel) {
+    // Contiguous blocks starting at the header
+    int last = loop.header + static_cast<int>(loop.blocks.size()) - 1;
+    if (last >= static_cast<int>(cfg.blocks.size()) || !loop.blocks.count(last)) return false;
+
+    std::vector<TAC*> instructions;
+    for (int id = loop.header; id <= last; id++) {
+        if (!loop.blocks.count(id)) return false;
+        for (TAC* tac : cfg.blocks[id].instructions) {
+            instructions.push_back(tac);
+        }
+    }
+    if (instructions.size() < 5) return false;
+
+    TAC* label = instructions[0];
+    TAC* compare = instructions[1];
+    TAC* exitTest = instructions[2];
+    TAC* increment = instructions[instructions.size() - 2];
+    TAC* backEdge = instructions.back();
+    if (label->getType() != TACType::LABEL || exitTest->getType() != TACType::IFZ ||
+        exitTest->getOp1() != compare->getRes() || backEdge->getType() != TACType::JUMP ||
+        backEdge->getOp1() != label->getOp1()) {
+        return false;
+    }
+
+    switch (compare->getType()) {
+        case TACType::LT: kernel.index = compare->getOp1(); kernel.limit = compare->getOp2(); kernel.inclusive = false; break;
+        case TACType::LE: kernel.index = compare->getOp1(); kernel.limit = compare->getOp2(); kernel.inclusive = true; break;
+        case TACType::GT: kernel.index = compare->getOp2(); kernel.limit = compare->getOp1(); kernel.inclusive = false; break;
+        case TACType::GE: kernel.index = compare->getOp2(); kernel.limit = compare->getOp1(); kernel.inclusive = true; break;
+        default: return false;
+    }
+    if (!isVariableSymbol(kernel.index) || kernel.index->getIdentifierType() == identifierType::VECTOR) return false;
+    if (!isVariableSymbol(kernel.limit) && !isIntegerLiteral(kernel.limit)) return false;
+    if (kernel.limit == kernel.index) return false;
+
+    if (increment->getType() != TACType::ADD || increment->getRes() != kernel.index ||
+        increment->getOp1() != kernel.index || !isIntegerLiteral(increment->getOp2()) ||
+        increment->getOp2()->getLexeme() != "1") {
+        return false;
+    }
+
+    std::map<Symbol*, int> loopDefinitions;
+    for (TAC* tac : instructions) {
+        Symbol* defined = getDefinedSymbol(tac);
+        if (defined) loopDefinitions[defined]++;
+    }
+    if (loopDefinitions[kernel.index] != 1 || loopDefinitions.count(kernel.limit)) return false;
+
+    // Values computed by the loop other than the counter and the accumulators must die with it
+    auto exitBlock = cfg.labelBlocks.find(exitTest->getOp2());
+    if (exitBlock == cfg.labelBlocks.end() || loop.blocks.count(exitBlock->second)) return false;
+    for (const auto& definition : loopDefinitions) {
+        Symbol* symbol = definition.first;
+        if (symbol->getIdentifierType() == identifierType::TEMP &&
+            liveness.liveIn[exitBlock->second].count(symbol)) {
+            return false;
+        }
+    }
+
+    std::vector<TAC*> body(instructions.begin() + 3, instructions.end() - 2);
+    KernelBuilder builder(kernel, loopDefinitions);
+    for (TAC* tac : body) {
+        if (!builder.addInstruction(tac)) return false;
+    }
+    return builder.finish(body);
+}
+
+TAC* optimizeVectorization(TAC* tacHead) {
+    if (!tacHead) return nullptr;
+
+    int loopsVectorized = 0;
+    int bulkLoops = 0;
+    std::vector<FunctionCFG> functions = buildCFG(tacHead);
+    for (FunctionCFG& cfg : functions) {
+        std::vector<std::vector<bool>> dominators = computeDominators(cfg);
+        Liveness liveness = computeLiveness(cfg);
+        for (const NaturalLoop& loop : findNaturalLoops(cfg, dominators)) {
+            if (!findPreheaderPosition(cfg, loop)) continue;
+
+            VectorKernel kernel;
+            if (!analyzeLoop(cfg, loop, liveness, kernel)) continue;
+            kernel.bulk = isBulkKernel(kernel);
+            if (kernel.bulk) bulkLoops++;
+
+            // The packed loop runs first, the original loop then finishes the remaining iterations
+            TAC* vectorLoop = new TAC(TACType::VECLOOP, nullptr, kernel.index, kernel.limit);
+            kernels[vectorLoop] = kernel;
+            insertPreheader(cfg, loop, std::vector<TAC*>(1, vectorLoop));
+            loopsVectorized++;
+        }
+    }
+
+    std::cout << "Vectorization completed: " << loopsVectorized << " loops vectorized (" << bulkLoops << " fill/copy)." << std::endl;
+
+    return tacHead;
+}
@@ -0,0 +1,65 @@
+// Federal University of Rio Grande do Sul - Institute of Informatics - Compilers 2025/1
+// Loop vectorizer header file made by Nathan Alonso Guimarães (00334437)
+
+#ifndef VECTORIZER_HPP
+#define VECTORIZER_HPP
+
+#include <vector>
+#include <utility>
+
+class TAC;
+class Symbol;
+
+// Operation computed by one node of a vectorized loop body, for every lane at once
+enum class LaneOperation {
+    LOAD,           // Element i of a vector
+    BROADCAST,      // Loop invariant scalar or literal copied to every lane
+    ADD,            // left + right
+    SUB,            // left - right
+    MUL,            // left * right (low 32 bits)
+    GT,             // left > right as 0/1 (inverted gives left <= right)
+    EQ,             // left == right as 0/1 (inverted gives left != right)
+    SELECT,         // right where left is nonzero, 0 elsewhere
+    ACCUMULATOR     // Running value of a max/min reduction (only compared, never computed)
+};
+
+// One node of the lane expression graph
+struct LaneNode {
+    LaneOperation operation;
+    Symbol* symbol;         // Vector for LOAD, scalar for BROADCAST and ACCUMULATOR
+    int left;               // Operand nodes (-1 if unused)
+    int right;
+    bool inverted;          // Negates the result of GT and EQ
+};
+
+// Kinds of values accumulated across all iterations
+enum class ReductionKind {
+    SUM,            // accumulator = accumulator + node
+    DIFFERENCE,     // accumulator = accumulator - node
+    MAX,            // accumulator = max(accumulator, node)
+    MIN             // accumulator = min(accumulator, node)
+};
+
+struct VectorReduction {
+    Symbol* accumulator;
+    ReductionKind kind;
+    int node;
+};
+
+// Loop "while (index < limit) { body; index = index + 1; }" whose body works element-wise on vectors
+struct VectorKernel {
+    Symbol* index;                                  // Loop counter, advanced by one per iteration
+    Symbol* limit;                                  // Loop runs while index < limit (or <= when inclusive)
+    bool inclusive;
+    std::vector<LaneNode> nodes;                    // Lane expressions, operands always before their users
+    std::vector<std::pair<Symbol*, int>> stores;    // vector[index] = node, in program order
+    std::vector<VectorReduction> reductions;
+    bool bulk;                                      // Every store fills or copies the whole range (lowered to rep stosl/movsl)
+};
+
+// Public interface functions
+TAC* optimizeVectorization(TAC* tacHead);                   // Adds a VECLOOP before every vectorizable loop
+const VectorKernel* getVectorKernel(TAC* tac);              // Kernel of a VECLOOP instruction
+std::vector<Symbol*> getVectorKernelOperands(TAC* tac);     // Variables and vectors read or written by a VECLOOP
+
+#endif // VECTORIZER_HPP